@@ -0,0 +1,235 @@
+#pragma once
+
+// Асинхронный журнал для измерительных программ. У каждого потока своё кольцо записей
+// (один писатель, один читатель), фоновый поток обходит кольца и выводит накопленное
+// одной пачкой. Поток, пишущий в журнал, только форматирует строку прямо в слот кольца и
+// публикует его атомарной записью, поэтому вывод не попадает внутрь критических секций
+// и не искажает замеры блокировок
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class AsyncLogger {
+public:
+    // Одна строка журнала; длиннее text не влезет и будет обрезана
+    struct Record {
+        uint16_t length = 0;
+        char text[126];
+
+        template <class T>
+        void append(const T& value) {
+            if constexpr (std::is_same<T, char>::value) {
+                put(std::string_view(&value, 1));
+            } else if constexpr (std::is_same<T, bool>::value) {
+                put(value ? "true" : "false");
+            } else if constexpr (std::is_integral<T>::value) {
+                char buf[24];
+                auto result = std::to_chars(buf, buf + sizeof(buf), value);
+                put(std::string_view(buf, result.ptr - buf));
+            } else if constexpr (std::is_floating_point<T>::value) {
+                char buf[32];
+                int len = std::snprintf(buf, sizeof(buf), "%g", static_cast<double>(value)); // Как cout по умолчанию
+                put(std::string_view(buf, len));
+            } else {
+                put(std::string_view(value));
+            }
+        }
+
+        // Последний байт оставлен под перевод строки
+        void put(std::string_view s) {
+            size_t n = std::min(s.size(), sizeof(text) - 1 - length);
+            std::memcpy(text + length, s.data(), n);
+            length += static_cast<uint16_t>(n);
+        }
+    };
+
+    AsyncLogger()
+        : drainer([this] { drainLoop(); })
+    {}
+
+    // Выводит всё, что успели записать, и останавливает фоновый поток
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wakeCv.notify_all();
+        drainer.join();
+    }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Строка из аргументов и перевод строки. Если кольцо потока заполнено, поток ждёт,
+    // пока фоновый поток его разгрузит: записи не теряются
+    template <class... Args>
+    void line(const Args&... args) {
+        Ring& ring = localRing();
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        if (tail - ring.head.load(std::memory_order_acquire) == ringSize) {
+            wake();
+            while (tail - ring.head.load(std::memory_order_acquire) == ringSize) {
+                std::this_thread::yield();
+            }
+        }
+        Record& record = ring.records[tail % ringSize];
+        record.length = 0;
+        (record.append(args), ...);
+        record.text[record.length++] = '\n';
+        ring.tail.store(tail + 1, std::memory_order_release);
+
+        // Будим фоновый поток, только если он мог уснуть: флаг pending сброшен. Барьер
+        // в паре с барьером в drainLoop гарантирует, что либо мы увидим сброшенный флаг,
+        // либо фоновый поток после сброса увидит эту строку
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!pending.load(std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    // Ждёт, пока будут выведены все строки, записанные до вызова
+    void flush() {
+        std::unique_lock<std::mutex> lock(mtx);
+        size_t epoch = ++flushRequested;
+        wakeCv.notify_all();
+        flushedCv.wait(lock, [&] { return flushDone >= epoch; });
+    }
+
+private:
+    static constexpr size_t ringSize = 256;
+
+    struct Ring {
+        alignas(64) std::atomic<size_t> head{0}; // Следующая строка для фонового потока
+        alignas(64) std::atomic<size_t> tail{0}; // Следующий свободный слот для владельца
+        std::atomic<bool> retired{false};        // Поток-владелец завершился
+        Record records[ringSize];
+    };
+
+    // Кольцо регистрируется при первой записи потока и снимается с учёта, когда поток
+    // завершился, а его строки выведены
+    struct RingHandle {
+        std::shared_ptr<Ring> ring;
+        ~RingHandle() {
+            if (ring) ring->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    // Взводит флаг ожидающих строк и будит фоновый поток. Мьютекс берётся только на
+    // переходе из простоя, поэтому пробуждение не теряется между проверкой условия и сном
+    void wake() {
+        if (pending.exchange(true, std::memory_order_seq_cst)) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        wakeCv.notify_one();
+    }
+
+    Ring& localRing() {
+        thread_local RingHandle handle;
+        if (!handle.ring) {
+            handle.ring = std::make_shared<Ring>();
+            std::lock_guard<std::mutex> lock(mtx);
+            rings.push_back(handle.ring);
+        }
+        return *handle.ring;
+    }
+
+    // Забирает из кольца всё опубликованное; возвращает true, если что-то было
+    static bool drainRing(Ring& ring, std::string& batch) {
+        size_t head = ring.head.load(std::memory_order_relaxed);
+        size_t tail = ring.tail.load(std::memory_order_acquire);
+        for (size_t i = head; i < tail; ++i) {
+            const Record& record = ring.records[i % ringSize];
+            batch.append(record.text, record.length);
+        }
+        ring.head.store(tail, std::memory_order_release);
+        return head != tail;
+    }
+
+    void drainLoop() {
+        std::vector<std::shared_ptr<Ring>> snapshot;
+        std::string batch;
+        for (;;) {
+            size_t epoch;
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                // Без строк, сброса и остановки поток спит, не просыпаясь по таймеру
+                wakeCv.wait(lock, [this] {
+                    return stopping || flushRequested > flushDone || pending.load(std::memory_order_relaxed);
+                });
+                pending.store(false, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                epoch = flushRequested;
+                stop = stopping;
+                // Завершённые потоки с пустыми кольцами больше не нужны
+                for (size_t i = 0; i < rings.size();) {
+                    Ring& ring = *rings[i];
+                    if (ring.retired.load(std::memory_order_acquire) &&
+                        ring.head.load(std::memory_order_relaxed) == ring.tail.load(std::memory_order_acquire)) {
+                        rings[i] = std::move(rings.back());
+                        rings.pop_back();
+                    } else {
+                        ++i;
+                    }
+                }
+                snapshot = rings;
+            }
+
+            // Пока находятся новые строки, обходим кольца повторно
+            bool drained = true;
+            while (drained) {
+                drained = false;
+                for (auto& ring : snapshot) {
+                    drained |= drainRing(*ring, batch);
+                }
+                if (batch.size() >= (1 << 16) || (!drained && !batch.empty())) {
+                    std::fwrite(batch.data(), 1, batch.size(), stdout);
+                    batch.clear();
+                }
+            }
+            std::fflush(stdout);
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                flushDone = epoch;
+            }
+            flushedCv.notify_all();
+            if (stop) return;
+        }
+    }
+
+    std::mutex mtx; // Список колец и состояние фонового потока; пишущий поток берёт его только при регистрации кольца
+    std::condition_variable wakeCv;
+    std::condition_variable flushedCv;
+    std::vector<std::shared_ptr<Ring>> rings;
+    size_t flushRequested = 0;
+    size_t flushDone = 0;
+    bool stopping = false;
+    std::atomic<bool> pending{false}; // Есть невыведенные строки или кольцо заполнено
+    std::thread drainer;
+};
+
+// Общий журнал программы; создаётся при первой записи
+inline AsyncLogger& asyncLogger() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+template <class... Args>
+void logLine(const Args&... args) {
+    asyncLogger().line(args...);
+}
+
+inline void logFlush() {
+    asyncLogger().flush();
+}
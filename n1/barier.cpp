@@ -6,7 +6,10 @@
 #include <string>
 #include <mutex>
 #include <condition_variable>
+#include "../logger.h"
 #include <atomic>
+#include <vector>
+#include <memory>
 using namespace std;
 using namespace chrono;
 
@@ -20,7 +23,9 @@ public:
         , barrier_broken(false)
     {}
 
-    // Метод для ожидания на барьере
+    // Метод для ожидания на барьере. Поток ждёт смены поколения, а не просто
+    // пробуждения, поэтому ложное пробуждение не выпустит его раньше времени, а поток,
+    // уже вошедший в следующую фазу, не спутает её с предыдущей
     void wait() {
         unique_lock<mutex> lock(mtx);
 
@@ -30,13 +35,15 @@ public:
 
         ++waiting; // Увеличиваем количество ожидающих потоков
 
-        // Если все потоки достигли барьера, пробуждаем их
+        // Если все потоки достигли барьера, открываем новое поколение и пробуждаем их
         if (waiting == count) {
-            waiting = 0; // Сбрасываем счётчик ожидания
+            waiting = 0; // Сбрасываем счётчик ожидания для следующей фазы
+            ++generation;
             cv.notify_all();
         } else {
-            // Иначе текущий поток ждёт
-            cv.wait(lock);
+            // Иначе текущий поток ждёт конца своего поколения
+            unsigned arrived = generation;
+            cv.wait(lock, [&] { return generation != arrived || barrier_broken; });
         }
     }
 
@@ -56,11 +63,122 @@ public:
 private:
     int count; // Общее количество потоков, которое нужно для открытия барьера
     int waiting; // Текущее количество потоков, ожидающих на барьере
+    unsigned generation = 0; // Номер фазы; растёт каждый раз, когда барьер открывается
     mutex mtx; // Мьютекс для синхронизации доступа к данным
     condition_variable cv; // Условная переменная для управления ожиданием
     atomic<bool> barrier_broken; // Флаг, указывающий, сломан ли барьер
 };
 
+// Подсказка процессору, что поток крутится в ожидании
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Ожидание в цикле: сначала pause, а после spinLimit итераций поток уступает процессор,
+// чтобы не отнимать его у потоков, которые ещё не дошли до барьера
+class SpinWait {
+public:
+    void pause() {
+        if (spins < spinLimit) {
+            ++spins;
+            cpuRelax();
+        } else {
+            this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr unsigned spinLimit = 256;
+
+    unsigned spins = 0;
+};
+
+// Барьер со сменой фазы (sense-reversing) без мьютекса. Прибывший поток уменьшает
+// счётчик; последний восстанавливает счётчик и переключает фазу, остальные крутятся
+// на чтении фазы. Счётчик восстанавливается до переключения, поэтому барьер сразу
+// готов к следующему кругу
+class SenseBarrier {
+public:
+    SenseBarrier(int count)
+        : count(count)
+        , remaining(count)
+    {}
+
+    void wait() {
+        unsigned current = phase.load(memory_order_relaxed);
+        if (remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+            remaining.store(count, memory_order_relaxed);
+            phase.store(current + 1, memory_order_release);
+            return;
+        }
+        SpinWait spin;
+        while (phase.load(memory_order_acquire) == current) {
+            spin.pause();
+        }
+    }
+
+private:
+    int count;
+    alignas(64) atomic<int> remaining;     // Сколько потоков ещё не пришло в текущей фазе
+    alignas(64) atomic<unsigned> phase{0}; // Чётность фазы и есть «смысл» барьера
+};
+
+// Барьер распространения (dissemination): за ceil(log2 count) раундов поток с номером id
+// в раунде r сигналит потоку (id + 2^r) % count и ждёт сигнала от (id - 2^r) % count.
+// Общего счётчика нет, каждый поток ждёт на своём флаге, так что прибытие не упирается
+// в одну кэш-линию и пробуждение не превращается в одновременный бросок всех потоков.
+// Флаги - счётчики эпизодов, поэтому их не нужно сбрасывать между фазами
+class DisseminationBarrier {
+public:
+    DisseminationBarrier(int count)
+        : count(count)
+        , episodes(new Padded[count])
+    {
+        while ((1 << rounds) < count) {
+            ++rounds;
+        }
+        flags.reset(new Padded[max(1, rounds * count)]);
+    }
+
+    // id - номер потока от 0 до count - 1
+    void wait(int id) {
+        unsigned episode = ++episodes[id].value; // Меняет только сам поток id
+        for (int r = 0; r < rounds; ++r) {
+            int partner = (id + (1 << r)) % count;
+            flags[r * count + partner].value.fetch_add(1, memory_order_release);
+            SpinWait spin;
+            while (static_cast<int>(flags[r * count + id].value.load(memory_order_acquire) - episode) < 0) {
+                spin.pause();
+            }
+        }
+    }
+
+private:
+    struct alignas(64) Padded {
+        atomic<unsigned> value{0};
+    };
+
+    int count;
+    int rounds = 0;
+    unique_ptr<Padded[]> episodes; // Сколько раз каждый поток входил в барьер
+    unique_ptr<Padded[]> flags;    // flags[r * count + id] - сигналы потоку id в раунде r
+};
+
+// Ожидание на барьере от имени потока id; барьерам с общим счётчиком номер не нужен
+template <class B>
+auto barrierWait(B& barrier, int id) -> decltype(barrier.wait(id)) {
+    barrier.wait(id);
+}
+
+template <class B>
+auto barrierWait(B& barrier, int) -> decltype(barrier.wait()) {
+    barrier.wait();
+}
+
 // Функция генерации случайного числа в диапазоне [a, b)
 size_t rnd(size_t a = 0, size_t b = INT32_MAX) {
     static auto now = system_clock::now().time_since_epoch().count();
@@ -82,15 +200,16 @@ string random_string(size_t symbolCnt) {
     return rndStr;
 }
 
-// Мьютекс для синхронизации вывода в консоль и файл
+// Мьютекс для синхронизации записи в файл
 mutex output_mutex;
 ofstream out("output.txt"); // Файл для записи результатов
 
-// Рабочая функция для потока
-void worker(int id, Barrier& barrier, int symbolCnt) {
+// Рабочая функция для потока; B - любой барьер из этого файла
+template <class B>
+void worker(int id, B& barrier, int symbolCnt) {
     auto start = high_resolution_clock::now(); // Фиксируем время начала работы потока
 
-    barrier.wait(); // Ожидание на барьере
+    barrierWait(barrier, id); // Ожидание на барьере
 
     // Генерация случайной строки и запись в файл
     output_mutex.lock();
@@ -101,26 +220,78 @@ void worker(int id, Barrier& barrier, int symbolCnt) {
     duration<double> duration = finish - start;
 
     // Вывод времени выполнения потока в консоль
-    {
-        lock_guard<mutex> lock(output_mutex);
-        cout << "поток " << id << ", время: " << duration.count() << " сек.\n";
-    }
+    logLine("поток ", id, ", время: ", duration.count(), " сек.");
 }
 
-int main() {
-    int symbolCnt, threadsCnt;
-    cin >> symbolCnt >> threadsCnt;
-    
-    Barrier barrier (threadsCnt);
-    
+// Запуск потоков, которые встречаются на барьере B и пишут строки в файл
+template <class B>
+void runWorkers(int symbolCnt, int threadsCnt) {
+    B barrier (threadsCnt);
+
     vector<thread> threads (threadsCnt);
 
     int i = 0;
     for (auto& th : threads) {
-        th = thread(worker, i++, ref(barrier), symbolCnt);
+        th = thread(worker<B>, i++, ref(barrier), symbolCnt);
     }
 
     for (auto& th : threads) {
         th.join();
     }
 }
+
+// Задержка барьера: threadsCnt потоков проходят phases фаз подряд без работы между ними.
+// Возвращает среднее время одной фазы в микросекундах. Создание потоков в замер не входит:
+// сначала все встречаются на прогревочной фазе, и только после неё поток 0 засекает время.
+// Из последней фазы поток 0 выходит не раньше, чем до неё дошли все, поэтому его замер
+// покрывает все phases фаз
+template <class B>
+double phaseLatency(int threadsCnt, int phases) {
+    B barrier (threadsCnt);
+    vector<thread> threads;
+    steady_clock::time_point start, end;
+
+    for (int t = 0; t < threadsCnt; ++t) {
+        threads.emplace_back([&, t] {
+            barrierWait(barrier, t);
+            if (t == 0) start = steady_clock::now();
+            for (int i = 0; i < phases; ++i) {
+                barrierWait(barrier, t);
+            }
+            if (t == 0) end = steady_clock::now();
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    duration<double, micro> elapsed = end - start;
+    return elapsed.count() / phases;
+}
+
+// barier [mutex|sense|dissemination] - потоки встречаются на выбранном барьере и пишут в файл
+// barier --bench <максимум потоков> <фаз> - задержка фазы для 1, 2, 4, ... потоков
+int main(int argc, char* argv[]) {
+    string variant = argc > 1 ? argv[1] : "mutex";
+
+    if (variant == "--bench") {
+        int maxThreads = argc > 2 ? stoi(argv[2]) : int(thread::hardware_concurrency());
+        int phases = argc > 3 ? stoi(argv[3]) : 10000;
+        for (int threadsCnt = 1; threadsCnt <= maxThreads; threadsCnt = threadsCnt * 2 > maxThreads && threadsCnt < maxThreads ? maxThreads : threadsCnt * 2) {
+            logLine("потоков ", threadsCnt, ": mutex ", phaseLatency<Barrier>(threadsCnt, phases),
+                    " мкс, sense ", phaseLatency<SenseBarrier>(threadsCnt, phases),
+                    " мкс, dissemination ", phaseLatency<DisseminationBarrier>(threadsCnt, phases), " мкс");
+        }
+        return 0;
+    }
+
+    int symbolCnt, threadsCnt;
+    cin >> symbolCnt >> threadsCnt;
+
+    if (variant == "mutex") runWorkers<Barrier>(symbolCnt, threadsCnt);
+    else if (variant == "sense") runWorkers<SenseBarrier>(symbolCnt, threadsCnt);
+    else if (variant == "dissemination") runWorkers<DisseminationBarrier>(symbolCnt, threadsCnt);
+    else {
+        cerr << "Неизвестный барьер: " << variant << "\n";
+        return 1;
+    }
+}
@@ -6,6 +6,10 @@
 #include <string>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "sync_common.h"
 using namespace std;
 using namespace chrono;
 
@@ -35,6 +39,36 @@ private:
     bool is_locked = false; // Флаг, указывающий, заблокирован ли ресурс
 };
 
+// Монитор на одном атомарном слове и futex: 0 - свободен, 1 - занят, 2 - занят и есть
+// ожидающие. Захват без конкуренции - одна операция compare-exchange, а освобождение
+// уходит в ядро будить поток, только если слово было 2
+class FutexMonitor {
+public:
+    void lock() {
+        int current = 0;
+        if (state.compare_exchange_strong(current, 1, memory_order_acquire, memory_order_relaxed)) {
+            return;
+        }
+        // Отмечаем, что есть ожидающие, и спим, пока монитор занят
+        if (current != 2) {
+            current = state.exchange(2, memory_order_acquire);
+        }
+        while (current != 0) {
+            futexWait(state, 2);
+            current = state.exchange(2, memory_order_acquire);
+        }
+    }
+
+    void unlock() {
+        if (state.exchange(0, memory_order_release) == 2) {
+            futexWake(state, 1);
+        }
+    }
+
+private:
+    atomic<int> state{0};
+};
+
 // Функция генерации случайного числа в диапазоне [a, b)
 size_t rnd(size_t a = 0, size_t b = INT32_MAX) {
     static auto now = system_clock::now().time_since_epoch().count(); // Используем текущее время для генератора
@@ -56,12 +90,11 @@ string random_string(size_t symbolCnt) {
     return rndStr;
 }
 
-// Мьютекс для синхронизации вывода в консоль и файл
-mutex output_mutex;
 ofstream out("output.txt"); // Открываем файл для записи результатов
 
-// Рабочая функция для потока
-void worker(int id, Monitor& monitor, int symbolCnt) {
+// Рабочая функция для потока; Mon - монитор с lock()/unlock()
+template <class Mon>
+void worker(int id, Mon& monitor, int symbolCnt) {
     auto start = high_resolution_clock::now(); // Фиксируем время начала работы потока
 
     monitor.lock(); // Блокируем ресурс для текущего потока
@@ -73,26 +106,76 @@ void worker(int id, Monitor& monitor, int symbolCnt) {
     duration<double> duration = finish - start;
 
     // Вывод времени выполнения потока в консоль
-    {
-        lock_guard<mutex> lock(output_mutex); // Блокируем вывод в консоль
-        cout << "поток " << id << ", время: " << duration.count() << " сек.\n";
-    }
+    logLine("поток ", id, ", время: ", duration.count(), " сек.");
 }
 
-int main() {
-    int symbolCnt, threadsCnt;
-    cin >> symbolCnt >> threadsCnt; // Вводим параметры: количество символов в строке и количество потоков
-    
-    Monitor monitor; // Создаём объект для синхронизации потоков
-    
+// Запуск потоков, пишущих строки в файл под монитором Mon
+template <class Mon>
+void runWorkers(int symbolCnt, int threadsCnt) {
+    Mon monitor; // Создаём объект для синхронизации потоков
+
     vector<thread> threads(threadsCnt); // Создаём вектор потоков
 
     int i = 0;
     for (auto& th : threads) {
-        th = thread(worker, i++, ref(monitor), symbolCnt); // Запускаем потоки
+        th = thread(worker<Mon>, i++, ref(monitor), symbolCnt); // Запускаем потоки
     }
 
     for (auto& th : threads) {
         th.join(); // Ожидаем завершения всех потоков
     }
-}
\ No newline at end of file
+}
+
+// Нагрузочный тест: threadsCnt потоков по iters раз захватывают монитор вокруг
+// увеличения общего счётчика. Выводит пропускную способность и время ожидания захвата
+template <class Mon>
+void benchMonitor(const string& name, int threadsCnt, int iters) {
+    Mon monitor;
+    long counter = 0;
+    vector<vector<int64_t>> waits(threadsCnt);
+    vector<thread> threads;
+
+    auto start = steady_clock::now();
+    for (int t = 0; t < threadsCnt; ++t) {
+        threads.emplace_back([&, t] {
+            waits[t].reserve(iters);
+            for (int i = 0; i < iters; ++i) {
+                auto before = steady_clock::now();
+                monitor.lock();
+                waits[t].push_back(duration_cast<nanoseconds>(steady_clock::now() - before).count());
+                ++counter;
+                monitor.unlock();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+
+    logAcquireStats(name, counter, elapsed.count(), waits, counter == long(threadsCnt) * iters ? "" : ", СЧЁТЧИК НЕ СОШЁЛСЯ");
+}
+
+// monitor [cv|futex] - потоки пишут в файл под выбранным монитором
+// monitor --bench <потоков> <захватов на поток> - сравнение реализаций
+int main(int argc, char* argv[]) {
+    string variant = argc > 1 ? argv[1] : "cv";
+
+    if (variant == "--bench") {
+        int threadsCnt = argc > 2 ? stoi(argv[2]) : int(thread::hardware_concurrency());
+        int iters = argc > 3 ? stoi(argv[3]) : 100000;
+        benchMonitor<Monitor>("cv", threadsCnt, iters);
+        benchMonitor<FutexMonitor>("futex", threadsCnt, iters);
+        return 0;
+    }
+
+    int symbolCnt, threadsCnt;
+    cin >> symbolCnt >> threadsCnt; // Вводим параметры: количество символов в строке и количество потоков
+
+    if (variant == "cv") runWorkers<Monitor>(symbolCnt, threadsCnt);
+    else if (variant == "futex") runWorkers<FutexMonitor>(symbolCnt, threadsCnt);
+    else {
+        cerr << "Неизвестный монитор: " << variant << "\n";
+        return 1;
+    }
+}
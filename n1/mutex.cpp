@@ -6,6 +6,7 @@
 #include <string>
 #include <mutex>
 #include <condition_variable>
+#include "../logger.h"
 using namespace std;
 using namespace chrono;
 
@@ -32,8 +33,6 @@ string random_string(size_t symbolCnt) {
     return rndStr;
 }
 
-// Мьютекс для синхронизации вывода в консоль и файл
-mutex output_mutex;
 ofstream out("output.txt"); // Открываем файл для записи результатов
 
 // Рабочая функция для потока
@@ -49,10 +48,7 @@ void worker(int id, mutex& mtx, int symbolCnt) {
     duration<double> duration = finish - start;
 
     // Вывод времени выполнения потока в консоль
-    {
-        lock_guard<mutex> lock(output_mutex); // Блокируем вывод в консоль
-        cout << "поток " << id << ", время: " << duration.count() << " сек.\n";
-    }
+    logLine("поток ", id, ", время: ", duration.count(), " сек.");
 }
 
 int main() {
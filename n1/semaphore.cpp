@@ -6,6 +6,10 @@
 #include <string>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "sync_common.h"
 using namespace std;
 using namespace chrono;
 
@@ -37,6 +41,43 @@ private:
     int available; // Количество доступных ресурсов
 };
 
+// Семафор на одном атомарном счётчике и futex. Захват без конкуренции - одна операция
+// compare-exchange, освобождение - одно атомарное сложение; в ядро поток уходит, только
+// когда ресурсов нет, а освобождающий будит спящих, только если они есть
+class FutexSemaphore {
+public:
+    FutexSemaphore(int init)
+        : available(init) {}
+
+    void acquire() {
+        int current = available.load(memory_order_relaxed);
+        for (;;) {
+            if (current > 0) {
+                if (available.compare_exchange_weak(current, current - 1, memory_order_acquire, memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+            // Счётчик ожидающих виден освобождающему раньше, чем поток проверит available в ядре
+            waiters.fetch_add(1, memory_order_seq_cst);
+            futexWait(available, 0);
+            waiters.fetch_sub(1, memory_order_relaxed);
+            current = available.load(memory_order_relaxed);
+        }
+    }
+
+    void release() {
+        available.fetch_add(1, memory_order_seq_cst);
+        if (waiters.load(memory_order_seq_cst) > 0) {
+            futexWake(available, 1);
+        }
+    }
+
+private:
+    atomic<int> available; // Количество доступных ресурсов
+    atomic<int> waiters{0}; // Потоков, которые собираются уснуть или спят в futex
+};
+
 // Функция генерации случайного числа в диапазоне [a, b)
 size_t rnd(size_t a = 0, size_t b = INT32_MAX) {
     static auto now = system_clock::now().time_since_epoch().count(); // Используем текущее время для генератора
@@ -58,12 +99,11 @@ string random_string(size_t symbolCnt) {
     return rndStr;
 }
 
-// Мьютекс для синхронизации вывода в консоль и файл
-mutex output_mutex;
 ofstream out("output.txt"); // Открываем файл для записи результатов
 
-// Рабочая функция для потока
-void worker(int id, Semaphore& semaphore, int symbolCnt) {
+// Рабочая функция для потока; Sem - семафор с acquire()/release()
+template <class Sem>
+void worker(int id, Sem& semaphore, int symbolCnt) {
     auto start = high_resolution_clock::now(); // Фиксируем время начала работы потока
 
     semaphore.acquire(); // Поток захватывает ресурс (ждёт, если ресурс не доступен)
@@ -75,26 +115,80 @@ void worker(int id, Semaphore& semaphore, int symbolCnt) {
     duration<double> duration = finish - start;
 
     // Вывод времени выполнения потока в консоль
-    {
-        lock_guard<mutex> lock(output_mutex); // Блокируем вывод в консоль
-        cout << "поток " << id << ", время: " << duration.count() << " сек.\n";
-    }
+    logLine("поток ", id, ", время: ", duration.count(), " сек.");
 }
 
-int main() {
-    int symbolCnt, threadsCnt;
-    cin >> symbolCnt >> threadsCnt; // Вводим параметры: количество символов в строке и количество потоков
-    
-    Semaphore semaphore(1); // Создаём семафор с 1 доступным ресурсом (позволяет только одному потоку работать с ресурсом)
-    
+// Запуск потоков, пишущих строки в файл под семафором Sem
+template <class Sem>
+void runWorkers(int symbolCnt, int threadsCnt) {
+    Sem semaphore(1); // Создаём семафор с 1 доступным ресурсом (позволяет только одному потоку работать с ресурсом)
+
     vector<thread> threads(threadsCnt); // Создаём вектор потоков
 
     int i = 0;
     for (auto& th : threads) {
-        th = thread(worker, i++, ref(semaphore), symbolCnt); // Запускаем потоки
+        th = thread(worker<Sem>, i++, ref(semaphore), symbolCnt); // Запускаем потоки
     }
 
     for (auto& th : threads) {
         th.join(); // Ожидаем завершения всех потоков
     }
-}
\ No newline at end of file
+}
+
+// Нагрузочный тест: threadsCnt потоков по iters раз захватывают один из permits ресурсов.
+// Выводит пропускную способность и время ожидания захвата, а также проверяет, что
+// ресурс одновременно держат не больше permits потоков
+template <class Sem>
+void benchSemaphore(const string& name, int threadsCnt, int iters, int permits) {
+    Sem semaphore(permits);
+    atomic<int> inside{0};
+    atomic<bool> exceeded{false};
+    vector<vector<int64_t>> waits(threadsCnt);
+    vector<thread> threads;
+
+    auto start = steady_clock::now();
+    for (int t = 0; t < threadsCnt; ++t) {
+        threads.emplace_back([&, t] {
+            waits[t].reserve(iters);
+            for (int i = 0; i < iters; ++i) {
+                auto before = steady_clock::now();
+                semaphore.acquire();
+                waits[t].push_back(duration_cast<nanoseconds>(steady_clock::now() - before).count());
+                if (inside.fetch_add(1) >= permits) exceeded = true;
+                inside.fetch_sub(1);
+                semaphore.release();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+
+    logAcquireStats(name, long(threadsCnt) * iters, elapsed.count(), waits, exceeded ? ", ПРЕВЫШЕНО ЧИСЛО РЕСУРСОВ" : "");
+}
+
+// semaphore [cv|futex] - потоки пишут в файл под выбранным семафором
+// semaphore --bench <потоков> <захватов на поток> [ресурсов] - сравнение реализаций
+int main(int argc, char* argv[]) {
+    string variant = argc > 1 ? argv[1] : "cv";
+
+    if (variant == "--bench") {
+        int threadsCnt = argc > 2 ? stoi(argv[2]) : int(thread::hardware_concurrency());
+        int iters = argc > 3 ? stoi(argv[3]) : 100000;
+        int permits = argc > 4 ? stoi(argv[4]) : 1;
+        benchSemaphore<Semaphore>("cv", threadsCnt, iters, permits);
+        benchSemaphore<FutexSemaphore>("futex", threadsCnt, iters, permits);
+        return 0;
+    }
+
+    int symbolCnt, threadsCnt;
+    cin >> symbolCnt >> threadsCnt; // Вводим параметры: количество символов в строке и количество потоков
+
+    if (variant == "cv") runWorkers<Semaphore>(symbolCnt, threadsCnt);
+    else if (variant == "futex") runWorkers<FutexSemaphore>(symbolCnt, threadsCnt);
+    else {
+        cerr << "Неизвестный семафор: " << variant << "\n";
+        return 1;
+    }
+}
@@ -7,6 +7,9 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include "sync_common.h"
 using namespace std;
 using namespace chrono;
 
@@ -31,6 +34,141 @@ private:
     atomic<bool> _locked{false}; // Переменная для хранения состояния блокировки
 };
 
+// Подсказка процессору, что поток крутится в ожидании: снижает энергопотребление и
+// освобождает ресурсы ядра соседнему гиперпотоку
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Ожидание в цикле: одна пауза между проверками длится units инструкций pause, а когда
+// их набралось spinLimit, поток вместо паузы один раз уступает процессор. Иначе, если
+// потоков больше, чем ядер, ожидающий сжигает весь квант, пока владелец блокировки или
+// следующий в очереди вытеснен и не может продвинуться
+class SpinWait {
+public:
+    void pause(unsigned units = 1) {
+        if (spins < spinLimit) {
+            spins += units;
+            for (unsigned i = 0; i < units; ++i) {
+                cpuRelax();
+            }
+        } else {
+            this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr unsigned spinLimit = 4096;
+
+    unsigned spins = 0;
+};
+
+// Спинлок test-and-test-and-set: ожидание идёт обычным чтением, которое не отнимает
+// кэш-линию у владельца, а захват пробуется только когда блокировка выглядит свободной.
+// После неудачной попытки пауза растёт вдвое, чтобы ожидающие не бросались на линию разом
+class TtasSpinlock {
+public:
+    void lock() {
+        unsigned delay = 1;
+        SpinWait wait;
+        for (;;) {
+            if (!_locked.load(memory_order_relaxed) && !_locked.exchange(true, memory_order_acquire)) {
+                return;
+            }
+            wait.pause(delay);
+            delay = min(delay * 2, maxDelay);
+        }
+    }
+
+    void unlock() {
+        _locked.store(false, memory_order_release);
+    }
+
+private:
+    static constexpr unsigned maxDelay = 1024; // Предел паузы, в инструкциях pause
+
+    atomic<bool> _locked{false};
+};
+
+// Билетный спинлок: потоки получают блокировку строго в порядке прихода. Каждый берёт
+// номер билета и ждёт, пока обслуживаемый номер не станет его; пауза пропорциональна
+// числу потоков впереди и пересчитывается при каждой проверке
+class TicketLock {
+public:
+    void lock() {
+        unsigned ticket = _next.fetch_add(1, memory_order_relaxed);
+        SpinWait wait;
+        for (;;) {
+            unsigned serving = _serving.load(memory_order_acquire);
+            if (serving == ticket) return;
+            wait.pause((ticket - serving) * 32);
+        }
+    }
+
+    void unlock() {
+        _serving.store(_serving.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+private:
+    alignas(64) atomic<unsigned> _next{0};    // Следующий выдаваемый билет
+    alignas(64) atomic<unsigned> _serving{0}; // Билет владельца блокировки
+};
+
+// Очередь MCS: каждый ожидающий крутится на флаге в своём узле, поэтому освобождение
+// затрагивает кэш-линию одного следующего потока, а не всех. Порядок - в порядке прихода.
+// Узел у каждого потока свой (thread_local), так что поток может держать только одну
+// MCS-блокировку одновременно
+class McsLock {
+public:
+    void lock() {
+        Node& node = localNode();
+        node.next.store(nullptr, memory_order_relaxed);
+        node.locked.store(true, memory_order_relaxed);
+        Node* prev = _tail.exchange(&node, memory_order_acq_rel);
+        if (prev) {
+            prev->next.store(&node, memory_order_release);
+            SpinWait wait;
+            while (node.locked.load(memory_order_acquire)) {
+                wait.pause();
+            }
+        }
+    }
+
+    void unlock() {
+        Node& node = localNode();
+        Node* succ = node.next.load(memory_order_acquire);
+        if (!succ) {
+            Node* expected = &node;
+            if (_tail.compare_exchange_strong(expected, nullptr, memory_order_release, memory_order_relaxed)) {
+                return; // Ожидающих нет
+            }
+            // Преемник уже встал в очередь, но ещё не прописал себя в node.next
+            SpinWait wait;
+            while (!(succ = node.next.load(memory_order_acquire))) {
+                wait.pause();
+            }
+        }
+        succ->locked.store(false, memory_order_release);
+    }
+
+private:
+    struct alignas(64) Node {
+        atomic<Node*> next{nullptr};
+        atomic<bool> locked{false};
+    };
+
+    static Node& localNode() {
+        thread_local Node node;
+        return node;
+    }
+
+    alignas(64) atomic<Node*> _tail{nullptr}; // Последний поток в очереди
+};
+
 // Функция генерации случайного числа в диапазоне [a, b)
 size_t rnd(size_t a = 0, size_t b = INT32_MAX) {
     static auto now = system_clock::now().time_since_epoch().count(); // Используем текущее время для генератора
@@ -52,12 +190,11 @@ string random_string(size_t symbolCnt) {
     return rndStr;
 }
 
-// Мьютекс для синхронизации вывода в консоль и файл
-mutex output_mutex;
 ofstream out("output.txt"); // Открываем файл для записи результатов
 
-// Рабочая функция для потока
-void worker(int id, Spinlock& spin, int symbolCnt) {
+// Рабочая функция для потока; Lock - любой спинлок с lock()/unlock()
+template <class Lock>
+void worker(int id, Lock& spin, int symbolCnt) {
     auto start = high_resolution_clock::now(); // Фиксируем время начала работы потока
 
     spin.lock(); // Поток захватывает блокировку
@@ -69,26 +206,80 @@ void worker(int id, Spinlock& spin, int symbolCnt) {
     duration<double> duration = finish - start;
 
     // Вывод времени выполнения потока в консоль
-    {
-        lock_guard<mutex> lock(output_mutex); // Блокируем вывод в консоль
-        cout << "поток " << id << ", время: " << duration.count() << " сек.\n";
-    }
+    logLine("поток ", id, ", время: ", duration.count(), " сек.");
 }
 
-int main() {
-    int symbolCnt, threadsCnt;
-    cin >> symbolCnt >> threadsCnt; // Вводим параметры: количество символов в строке и количество потоков
-    
-    Spinlock spin; // Создаём объект Spinlock
-    
+// Запуск потоков, пишущих строки в файл под спинлоком Lock
+template <class Lock>
+void runWorkers(int symbolCnt, int threadsCnt) {
+    Lock spin; // Создаём объект спинлока
+
     vector<thread> threads(threadsCnt); // Создаём вектор потоков
 
     int i = 0;
     for (auto& th : threads) {
-        th = thread(worker, i++, ref(spin), symbolCnt); // Запускаем потоки
+        th = thread(worker<Lock>, i++, ref(spin), symbolCnt); // Запускаем потоки
     }
 
     for (auto& th : threads) {
         th.join(); // Ожидаем завершения всех потоков
     }
-}
\ No newline at end of file
+}
+
+// Нагрузочный тест: threadsCnt потоков по iters раз захватывают блокировку вокруг
+// увеличения общего счётчика. Выводит пропускную способность и время ожидания захвата
+template <class Lock>
+void benchLock(const string& name, int threadsCnt, int iters) {
+    Lock spin;
+    long counter = 0;
+    vector<vector<int64_t>> waits(threadsCnt);
+    vector<thread> threads;
+
+    auto start = steady_clock::now();
+    for (int t = 0; t < threadsCnt; ++t) {
+        threads.emplace_back([&, t] {
+            waits[t].reserve(iters);
+            for (int i = 0; i < iters; ++i) {
+                auto before = steady_clock::now();
+                spin.lock();
+                waits[t].push_back(duration_cast<nanoseconds>(steady_clock::now() - before).count());
+                ++counter;
+                spin.unlock();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+
+    logAcquireStats(name, counter, elapsed.count(), waits, counter == long(threadsCnt) * iters ? "" : ", СЧЁТЧИК НЕ СОШЁЛСЯ");
+}
+
+// spin_lock [cas|ttas|ticket|mcs] - потоки пишут в файл под выбранным спинлоком
+// spin_lock --bench <потоков> <захватов на поток> - сравнение всех спинлоков
+int main(int argc, char* argv[]) {
+    string variant = argc > 1 ? argv[1] : "cas";
+
+    if (variant == "--bench") {
+        int threadsCnt = argc > 2 ? stoi(argv[2]) : int(thread::hardware_concurrency());
+        int iters = argc > 3 ? stoi(argv[3]) : 100000;
+        benchLock<Spinlock>("cas", threadsCnt, iters);
+        benchLock<TtasSpinlock>("ttas", threadsCnt, iters);
+        benchLock<TicketLock>("ticket", threadsCnt, iters);
+        benchLock<McsLock>("mcs", threadsCnt, iters);
+        return 0;
+    }
+
+    int symbolCnt, threadsCnt;
+    cin >> symbolCnt >> threadsCnt; // Вводим параметры: количество символов в строке и количество потоков
+
+    if (variant == "cas") runWorkers<Spinlock>(symbolCnt, threadsCnt);
+    else if (variant == "ttas") runWorkers<TtasSpinlock>(symbolCnt, threadsCnt);
+    else if (variant == "ticket") runWorkers<TicketLock>(symbolCnt, threadsCnt);
+    else if (variant == "mcs") runWorkers<McsLock>(symbolCnt, threadsCnt);
+    else {
+        cerr << "Неизвестный спинлок: " << variant << "\n";
+        return 1;
+    }
+}
@@ -6,6 +6,7 @@
 #include <string>
 #include <mutex>
 #include <condition_variable>
+#include "../logger.h"
 using namespace std;
 using namespace chrono;
 
@@ -30,8 +31,6 @@ string random_string(size_t symbolCnt) {
     return rndStr;
 }
 
-// Мьютекс для синхронизации вывода в консоль и файл
-mutex output_mutex;
 condition_variable cv; // Условная переменная для синхронизации
 bool outIsFree = true; // Флаг, указывающий, свободен ли поток для записи в файл
 ofstream out("output.txt"); // Открываем файл для записи результатов
@@ -59,10 +58,7 @@ void worker(int id, mutex& mtx, int symbolCnt) {
     duration<double> duration = finish - start; // Вычисляем время выполнения потока
 
     // Вывод времени выполнения потока в консоль
-    {
-        lock_guard<mutex> lock(output_mutex); // Блокируем вывод в консоль
-        cout << "поток " << id << ", время: " << duration.count() << " сек.\n";
-    }
+    logLine("поток ", id, ", время: ", duration.count(), " сек.");
 }
 
 int main() {
@@ -0,0 +1,42 @@
+#pragma once
+
+// Общее для программ n1: ожидание на futex и сводка нагрузочных тестов примитивов
+// синхронизации
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../logger.h"
+
+// Ожидание на адресе атомарного слова через futex: поток засыпает в ядре, только если
+// слово всё ещё равно expected, поэтому пробуждение между проверкой и сном не теряется
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex работает с 32-битным словом");
+
+inline void futexWait(std::atomic<int>& word, int expected) {
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+// Будит до count потоков, спящих на слове
+inline void futexWake(std::atomic<int>& word, int count) {
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+// Строка итога нагрузочного теста: захватов в секунду и перцентили времени ожидания
+// захвата по всем потокам (waits[t] - замеры потока t в наносекундах). problem - пометка
+// о нарушении, пустая, если проверка теста прошла
+inline void logAcquireStats(const std::string& name, long acquires, double seconds,
+                            const std::vector<std::vector<int64_t>>& waits, const char* problem) {
+    std::vector<int64_t> all;
+    for (auto& w : waits) {
+        all.insert(all.end(), w.begin(), w.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto at = [&](double p) { return all.empty() ? 0 : all[std::min(all.size() - 1, size_t(p * all.size()))]; };
+    logLine(name, ": ", static_cast<long>(acquires / seconds), " захватов/с, ожидание p50 ", at(0.5),
+            " нс, p99 ", at(0.99), " нс, максимум ", all.empty() ? 0 : all.back(), " нс", problem);
+}
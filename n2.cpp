@@ -2,9 +2,37 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <memory>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <chrono>
 #include <random>
 #include <ctime>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DATES_X86 1
+#endif
 
 struct Date {
     int day;
@@ -38,24 +66,92 @@ Date generateRandomDate() {
     return date;
 }
 
+// Счётчиковый генератор (SplitMix64): i-е число потока seed вычисляется напрямую,
+// без общего состояния, поэтому результат не зависит от разбиения массива между потоками
+inline uint64_t counterRandom(uint64_t seed, uint64_t counter) {
+    uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Дата из 64 случайных бит: три 21-битных поля, каждое масштабируется умножением на размер диапазона.
+// Распределение то же, что у generateRandomDate
+inline Date dateFromRandom(uint64_t bits) {
+    const uint64_t field = (1ull << 21) - 1;
+    Date date;
+    date.year = 1900 + static_cast<int>(((bits & field) * 201) >> 21);
+    date.month = 1 + static_cast<int>((((bits >> 21) & field) * 12) >> 21);
+    int day = 1 + static_cast<int>((((bits >> 42) & field) * 31) >> 21);
+    date.day = std::min(day, (date.month == 2 ? 28 : 30));
+    return date;
+}
+
+// Заполнение позиций [first, last) массива: дата с номером i всегда одна и та же для данного seed
+void fillRandomDates(Date* dates, size_t first, size_t last, uint64_t seed) {
+    for (size_t i = first; i < last; ++i) {
+        dates[i] = dateFromRandom(counterRandom(seed, i));
+    }
+}
+
+// Параллельная генерация в заранее выделенный массив; одинаковый seed даёт одинаковые даты
+// при любом числе потоков
+void generateRandomDates(Date* dates, size_t count, uint64_t seed, int num_threads) {
+    size_t parts = std::max<size_t>(1, std::min<size_t>(num_threads, count));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < parts; ++i) {
+        threads.emplace_back(fillRandomDates, dates, count * i / parts, count * (i + 1) / parts, seed);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void generateRandomDates(std::vector<Date>& dates, uint64_t seed, int num_threads) {
+    generateRandomDates(dates.data(), dates.size(), seed, num_threads);
+}
+
+// Случайный seed для невоспроизводимых запусков
+uint64_t randomSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
+
+// Функция поиска дат в диапазоне на отрезке [first, last)
+void findDatesInRange(const Date* first, const Date* last, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    for (const Date* date = first; date != last; ++date) {
+        if (*date >= d1 && *date <= d2) {
+            result.push_back(*date);
+        }
+    }
+}
+
 // Функция поиска дат в диапазоне
 void findDatesInRange(const std::vector<Date>& dates, const Date& d1, const Date& d2, std::vector<Date>& result) {
-    for (const auto& date : dates) {
-        if (date >= d1 && date <= d2) {
-            result.push_back(date);
-        }
+    findDatesInRange(dates.data(), dates.data() + dates.size(), d1, d2, result);
+}
+
+// Дописывает частичные результаты потоков в result по порядку, резервируя место ровно под них
+void concatPartials(const std::vector<std::vector<Date>>& partial_results, std::vector<Date>& result) {
+    size_t total = 0;
+    for (const auto& part : partial_results) {
+        total += part.size();
+    }
+    result.reserve(result.size() + total);
+    for (const auto& part : partial_results) {
+        result.insert(result.end(), part.begin(), part.end());
     }
 }
 
-void findDatesInRangeParallel(const std::vector<Date>& dates, const Date& d1, const Date& d2, std::vector<Date>& result, int num_threads) {
+void findDatesInRangeParallel(const Date* dates, size_t count, const Date& d1, const Date& d2, std::vector<Date>& result, int num_threads) {
     std::vector<std::thread> threads;
     std::vector<std::vector<Date>> partial_results(num_threads);
-    size_t chunk_size = dates.size() / num_threads;
+    size_t chunk_size = count / num_threads;
 
     for (int i = 0; i < num_threads; ++i) {
         size_t start_idx = i * chunk_size;
-        size_t end_idx = (i == num_threads - 1) ? dates.size() : (i + 1) * chunk_size;
-        threads.emplace_back([&dates, d1, d2, start_idx, end_idx, &partial_results, i]() {
+        size_t end_idx = (i == num_threads - 1) ? count : (i + 1) * chunk_size;
+        threads.emplace_back([dates, d1, d2, start_idx, end_idx, &partial_results, i]() {
             for (size_t j = start_idx; j < end_idx; ++j) {
                 if (dates[j] >= d1 && dates[j] <= d2) {
                     partial_results[i].push_back(dates[j]);
@@ -68,42 +164,1926 @@ void findDatesInRangeParallel(const std::vector<Date>& dates, const Date& d1, co
         thread.join();
     }
 
-    result.reserve(dates.size()); // Предварительное резервирование памяти
-    for (const auto& part : partial_results) {
-        result.insert(result.end(), part.begin(), part.end());
+    concatPartials(partial_results, result);
+}
+
+void findDatesInRangeParallel(const std::vector<Date>& dates, const Date& d1, const Date& d2, std::vector<Date>& result, int num_threads) {
+    findDatesInRangeParallel(dates.data(), dates.size(), d1, d2, result, num_threads);
+}
+
+// Упаковка даты в один сортируемый 32-битный ключ: год << 9 | месяц << 5 | день.
+// Порядок ключей совпадает с порядком дат (год, месяц, день) при месяце 1..12 и дне 1..31
+inline uint32_t packDate(const Date& date) {
+    return (static_cast<uint32_t>(date.year) << 9) | (static_cast<uint32_t>(date.month) << 5) | static_cast<uint32_t>(date.day);
+}
+
+inline Date unpackDate(uint32_t key) {
+    Date date;
+    date.day = static_cast<int>(key & 31);
+    date.month = static_cast<int>((key >> 5) & 15);
+    date.year = static_cast<int>(key >> 9);
+    return date;
+}
+
+// Колоночное представление дат (structure-of-arrays): один столбец упакованных ключей
+struct DateColumn {
+    std::vector<uint32_t> keys;
+};
+
+DateColumn buildDateColumn(const std::vector<Date>& dates) {
+    DateColumn column;
+    column.keys.resize(dates.size());
+    for (size_t i = 0; i < dates.size(); ++i) {
+        column.keys[i] = packDate(dates[i]);
     }
+    return column;
 }
 
-int main() {
-    // Параметры
-    size_t data_size = 10000000; // Размер массива данных
-    int num_threads = 500;       // Количество потоков
-    Date d1 = {1, 1, 2000};    // Начало диапазона
-    Date d2 = {31, 12, 2020};  // Конец диапазона
+// Набор инструкций для фильтрации ключей
+enum class SimdLevel {
+    scalar,
+    sse2,
+    avx2
+};
 
-    // Генерация массива дат
-    std::vector<Date> dates(data_size);
-    for (auto& date : dates) {
-        date = generateRandomDate();
+SimdLevel detectSimdLevel() {
+#ifdef DATES_X86
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::avx2;
+    return SimdLevel::sse2;
+#else
+    return SimdLevel::scalar;
+#endif
+}
+
+// Все фильтры отбирают ключи с (key - lo) <= (hi - lo) в беззнаковой арифметике,
+// то есть lo <= key <= hi одним сравнением без ветвлений.
+// Буфер out должен вмещать count + 8 индексов: векторные ядра пишут с запасом.
+
+// Скалярный проход по [begin, end): пишет индекс всегда, а сдвигает выход только при совпадении
+size_t filterKeysRange(const uint32_t* keys, size_t begin, size_t end, uint32_t lo, uint32_t span, uint32_t* out) {
+    size_t found = 0;
+    for (size_t i = begin; i < end; ++i) {
+        out[found] = static_cast<uint32_t>(i);
+        found += (keys[i] - lo) <= span;
     }
+    return found;
+}
 
-    // Однопоточная обработка
-    auto start_single = std::chrono::high_resolution_clock::now();
-    std::vector<Date> result_single;
-    findDatesInRange(dates, d1, d2, result_single);
-    auto end_single = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed_single = end_single - start_single;
+// Скалярный фильтр: запасной путь и эталон для проверки векторных ядер
+size_t filterKeysScalar(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi, uint32_t* out) {
+    return filterKeysRange(keys, 0, count, lo, hi - lo, out);
+}
 
-    // Многопоточная обработка
-    auto start_multi = std::chrono::high_resolution_clock::now();
-    std::vector<Date> result_multi;
-    findDatesInRangeParallel(dates, d1, d2, result_multi, num_threads);
-    auto end_multi = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed_multi = end_multi - start_multi;
+#ifdef DATES_X86
+// Таблица уплотнения: для каждой маски совпадений - смещения совпавших элементов
+template <size_t Lanes>
+struct CompactTable {
+    std::array<std::array<uint32_t, Lanes>, (1u << Lanes)> offsets;
 
-    // Вывод результатов
-    std::cout << "Однопоточная обработка: " << elapsed_single.count() << " секунд, найдено " << result_single.size() << " дат.\n";
-    std::cout << "Многопоточная обработка: " << elapsed_multi.count() << " секунд, найдено " << result_multi.size() << " дат.\n";
+    CompactTable() {
+        for (uint32_t mask = 0; mask < (1u << Lanes); ++mask) {
+            size_t n = 0;
+            offsets[mask].fill(0);
+            for (uint32_t lane = 0; lane < Lanes; ++lane) {
+                if (mask & (1u << lane)) offsets[mask][n++] = lane;
+            }
+        }
+    }
+};
 
-    return 0;
-}
\ No newline at end of file
+size_t filterKeysSse2(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi, uint32_t* out) {
+    static const CompactTable<4> table;
+    // Беззнаковое сравнение через знаковое: инвертируем старший бит
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    const __m128i vlo = _mm_set1_epi32(static_cast<int>(lo));
+    const __m128i vspan = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(hi - lo)), sign);
+
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        __m128i rel = _mm_xor_si128(_mm_sub_epi32(k, vlo), sign);
+        __m128i miss = _mm_cmpgt_epi32(rel, vspan);
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(miss))) & 0xF;
+
+        __m128i offsets = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.offsets[mask].data()));
+        __m128i idx = _mm_add_epi32(offsets, _mm_set1_epi32(static_cast<int>(i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + found), idx);
+        found += __builtin_popcount(mask);
+    }
+
+    return found + filterKeysRange(keys, i, count, lo, hi - lo, out + found);
+}
+
+__attribute__((target("avx2")))
+size_t filterKeysAvx2(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi, uint32_t* out) {
+    static const CompactTable<8> table;
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i vlo = _mm256_set1_epi32(static_cast<int>(lo));
+    const __m256i vspan = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(hi - lo)), sign);
+
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i rel = _mm256_xor_si256(_mm256_sub_epi32(k, vlo), sign);
+        __m256i miss = _mm256_cmpgt_epi32(rel, vspan);
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(miss))) & 0xFF;
+
+        __m256i offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.offsets[mask].data()));
+        __m256i idx = _mm256_add_epi32(offsets, _mm256_set1_epi32(static_cast<int>(i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + found), idx);
+        found += __builtin_popcount(mask);
+    }
+
+    return found + filterKeysRange(keys, i, count, lo, hi - lo, out + found);
+}
+#endif
+
+size_t filterKeys(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi, uint32_t* out, SimdLevel level) {
+    if (lo > hi) return 0;
+#ifdef DATES_X86
+    if (level == SimdLevel::avx2) return filterKeysAvx2(keys, count, lo, hi, out);
+    if (level == SimdLevel::sse2) return filterKeysSse2(keys, count, lo, hi, out);
+#endif
+    return filterKeysScalar(keys, count, lo, hi, out);
+}
+
+// Колоночный фильтр идёт блоками по filter_block строк через небольшой буфер индексов,
+// который остаётся в кэше, вместо буфера на весь столбец при любой селективности
+constexpr size_t filter_block = 4096;
+
+// Фильтрует блоки столбца и для каждого блока вызывает emit(begin, indices, found)
+// с индексами совпавших строк относительно начала блока
+template <class Emit>
+void filterColumnBlocks(const DateColumn& column, const Date& d1, const Date& d2, SimdLevel level, Emit&& emit) {
+    uint32_t lo = packDate(d1);
+    uint32_t hi = packDate(d2);
+    std::array<uint32_t, filter_block + 8> scratch;
+    for (size_t begin = 0; begin < column.keys.size(); begin += filter_block) {
+        size_t count = std::min(filter_block, column.keys.size() - begin);
+        size_t found = filterKeys(column.keys.data() + begin, count, lo, hi, scratch.data(), level);
+        emit(begin, scratch.data(), found);
+    }
+}
+
+// Поиск индексов дат в диапазоне по колоночному представлению
+void findIndicesInRange(const DateColumn& column, const Date& d1, const Date& d2, std::vector<uint32_t>& indices, SimdLevel level) {
+    indices.clear();
+    filterColumnBlocks(column, d1, d2, level, [&](size_t begin, const uint32_t* block, size_t found) {
+        for (size_t i = 0; i < found; ++i) {
+            indices.push_back(static_cast<uint32_t>(begin + block[i]));
+        }
+    });
+}
+
+// Колоночный поиск дат в диапазоне: векторный фильтр + сборка дат по найденным индексам
+void findDatesInRangeColumnar(const DateColumn& column, const Date& d1, const Date& d2, std::vector<Date>& result, SimdLevel level) {
+    filterColumnBlocks(column, d1, d2, level, [&](size_t begin, const uint32_t* block, size_t found) {
+        const uint32_t* keys = column.keys.data() + begin;
+        for (size_t i = 0; i < found; ++i) {
+            result.push_back(unpackDate(keys[block[i]]));
+        }
+    });
+}
+
+// Подсчёт ключей в [lo, hi] без записи индексов
+size_t countKeysScalar(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi) {
+    uint32_t span = hi - lo;
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        found += (keys[i] - lo) <= span;
+    }
+    return found;
+}
+
+// Векторные ядра копят число несовпадений в 32-битных счётчиках (сравнение даёт -1 на элемент)
+// и сбрасывают их в общую сумму раньше, чем счётчики могут переполниться
+const size_t count_flush_rows = size_t(1) << 30;
+
+#ifdef DATES_X86
+size_t countKeysSse2(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi) {
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    const __m128i vlo = _mm_set1_epi32(static_cast<int>(lo));
+    const __m128i vspan = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(hi - lo)), sign);
+    size_t vector_rows = count - count % 4;
+
+    size_t found = 0;
+    for (size_t start = 0; start < vector_rows; start += count_flush_rows) {
+        size_t stop = std::min(vector_rows, start + count_flush_rows);
+        __m128i misses = _mm_setzero_si128();
+        for (size_t i = start; i < stop; i += 4) {
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i rel = _mm_xor_si128(_mm_sub_epi32(k, vlo), sign);
+            misses = _mm_add_epi32(misses, _mm_cmpgt_epi32(rel, vspan));
+        }
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), misses);
+        size_t missed = 0;
+        for (uint32_t lane : lanes) {
+            missed += static_cast<uint32_t>(0u - lane);
+        }
+        found += (stop - start) - missed;
+    }
+    return found + countKeysScalar(keys + vector_rows, count - vector_rows, lo, hi);
+}
+
+__attribute__((target("avx2")))
+size_t countKeysAvx2(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi) {
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i vlo = _mm256_set1_epi32(static_cast<int>(lo));
+    const __m256i vspan = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(hi - lo)), sign);
+    size_t vector_rows = count - count % 8;
+
+    size_t found = 0;
+    for (size_t start = 0; start < vector_rows; start += count_flush_rows) {
+        size_t stop = std::min(vector_rows, start + count_flush_rows);
+        __m256i misses = _mm256_setzero_si256();
+        for (size_t i = start; i < stop; i += 8) {
+            __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i rel = _mm256_xor_si256(_mm256_sub_epi32(k, vlo), sign);
+            misses = _mm256_add_epi32(misses, _mm256_cmpgt_epi32(rel, vspan));
+        }
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), misses);
+        size_t missed = 0;
+        for (uint32_t lane : lanes) {
+            missed += static_cast<uint32_t>(0u - lane);
+        }
+        found += (stop - start) - missed;
+    }
+    return found + countKeysScalar(keys + vector_rows, count - vector_rows, lo, hi);
+}
+#endif
+
+size_t countKeys(const uint32_t* keys, size_t count, uint32_t lo, uint32_t hi, SimdLevel level) {
+    if (lo > hi) return 0;
+#ifdef DATES_X86
+    if (level == SimdLevel::avx2) return countKeysAvx2(keys, count, lo, hi);
+    if (level == SimdLevel::sse2) return countKeysSse2(keys, count, lo, hi);
+#endif
+    return countKeysScalar(keys, count, lo, hi);
+}
+
+// Число дат в диапазоне по колоночному представлению, без сборки результата
+size_t countDatesInRange(const DateColumn& column, const Date& d1, const Date& d2, SimdLevel level) {
+    return countKeys(column.keys.data(), column.keys.size(), packDate(d1), packDate(d2), level);
+}
+
+// Число дат в диапазоне на отрезке [first, last): сравнение по упакованному ключу без ветвлений
+size_t countDatesInRange(const Date* first, const Date* last, const Date& d1, const Date& d2) {
+    uint32_t lo = packDate(d1);
+    uint32_t hi = packDate(d2);
+    if (lo > hi) return 0;
+    uint32_t span = hi - lo;
+    size_t found = 0;
+    for (const Date* date = first; date != last; ++date) {
+        found += (packDate(*date) - lo) <= span;
+    }
+    return found;
+}
+
+size_t countDatesInRange(const std::vector<Date>& dates, const Date& d1, const Date& d2) {
+    return countDatesInRange(dates.data(), dates.data() + dates.size(), d1, d2);
+}
+
+// Гистограмма найденных дат по годам и месяцам: counts[(year - first_year) * 12 + month - 1].
+// Годы берутся из границ диапазона, за их пределами совпадений быть не может
+struct DateHistogram {
+    int first_year = 0;
+    std::vector<size_t> counts;
+
+    size_t at(int year, int month) const {
+        return counts[static_cast<size_t>(year - first_year) * 12 + month - 1];
+    }
+
+    size_t yearTotal(int year) const {
+        size_t total = 0;
+        for (int month = 1; month <= 12; ++month) {
+            total += at(year, month);
+        }
+        return total;
+    }
+};
+
+// Пустая гистограмма под диапазон [d1, d2]
+DateHistogram makeHistogram(const Date& d1, const Date& d2) {
+    DateHistogram histogram;
+    histogram.first_year = d1.year;
+    if (d1 <= d2) histogram.counts.assign(static_cast<size_t>(d2.year - d1.year + 1) * 12, 0);
+    return histogram;
+}
+
+void addToHistogram(const Date* first, const Date* last, const Date& d1, const Date& d2, DateHistogram& histogram) {
+    if (histogram.counts.empty()) return;
+    for (const Date* date = first; date != last; ++date) {
+        if (*date >= d1 && *date <= d2) {
+            ++histogram.counts[static_cast<size_t>(date->year - histogram.first_year) * 12 + date->month - 1];
+        }
+    }
+}
+
+DateHistogram histogramDatesInRange(const std::vector<Date>& dates, const Date& d1, const Date& d2) {
+    DateHistogram histogram = makeHistogram(d1, d2);
+    addToHistogram(dates.data(), dates.data() + dates.size(), d1, d2, histogram);
+    return histogram;
+}
+
+// Индекс по датам: отсортированные ключи для поиска и даты в том же порядке для копирования
+struct DateIndex {
+    std::vector<uint32_t> keys;
+    std::vector<Date> dates;
+};
+
+// Восстановление отсортированных дат по отсортированным ключам
+void fillIndexDates(DateIndex& index) {
+    index.dates.resize(index.keys.size());
+    for (size_t i = 0; i < index.keys.size(); ++i) {
+        index.dates[i] = unpackDate(index.keys[i]);
+    }
+}
+
+DateIndex buildDateIndex(const std::vector<Date>& dates) {
+    DateIndex index;
+    index.keys = buildDateColumn(dates).keys;
+    std::sort(index.keys.begin(), index.keys.end());
+    fillIndexDates(index);
+    return index;
+}
+
+// Параллельное построение индекса: сортировка кусков в потоках, затем попарные слияния
+DateIndex buildDateIndexParallel(const std::vector<Date>& dates, int num_threads) {
+    DateIndex index;
+    size_t n = dates.size();
+    size_t parts = std::max<size_t>(1, std::min<size_t>(num_threads, n));
+    std::vector<size_t> bounds(parts + 1);
+    for (size_t i = 0; i <= parts; ++i) {
+        bounds[i] = n * i / parts;
+    }
+
+    std::vector<uint32_t> keys(n);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < parts; ++i) {
+        threads.emplace_back([&dates, &keys, &bounds, i]() {
+            for (size_t j = bounds[i]; j < bounds[i + 1]; ++j) {
+                keys[j] = packDate(dates[j]);
+            }
+            std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1]);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Каждый раунд сливает соседние пары кусков, пока не останется один
+    std::vector<uint32_t> buffer(n);
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged_bounds;
+        threads.clear();
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            merged_bounds.push_back(bounds[i]);
+            size_t begin = bounds[i];
+            size_t middle = bounds[i + 1];
+            size_t end = (i + 2 < bounds.size()) ? bounds[i + 2] : middle;
+            threads.emplace_back([&keys, &buffer, begin, middle, end]() {
+                std::merge(keys.begin() + begin, keys.begin() + middle,
+                           keys.begin() + middle, keys.begin() + end,
+                           buffer.begin() + begin);
+            });
+        }
+        merged_bounds.push_back(n);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        keys.swap(buffer);
+        bounds.swap(merged_bounds);
+    }
+
+    index.keys = std::move(keys);
+    index.dates.resize(n);
+    threads.clear();
+    for (size_t i = 0; i < parts; ++i) {
+        size_t begin = n * i / parts;
+        size_t end = n * (i + 1) / parts;
+        threads.emplace_back([&index, begin, end]() {
+            for (size_t j = begin; j < end; ++j) {
+                index.dates[j] = unpackDate(index.keys[j]);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return index;
+}
+
+// Первая позиция с ключом >= key: бинарный поиск без ветвлений
+size_t lowerBoundKey(const std::vector<uint32_t>& keys, uint32_t key) {
+    const uint32_t* base = keys.data();
+    size_t len = keys.size();
+    if (len == 0) return 0;
+    while (len > 1) {
+        size_t half = len / 2;
+        base = (base[half - 1] < key) ? base + half : base;
+        len -= half;
+    }
+    return static_cast<size_t>(base - keys.data()) + (*base < key);
+}
+
+// Поиск дат в диапазоне по индексу: два бинарных поиска и копирование непрерывного отрезка.
+// Даты возвращаются в отсортированном порядке
+void findDatesInRangeIndexed(const DateIndex& index, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    uint32_t lo = packDate(d1);
+    uint32_t hi = packDate(d2);
+    if (lo > hi) return;
+    size_t first = lowerBoundKey(index.keys, lo);
+    size_t last = (hi == UINT32_MAX) ? index.keys.size() : lowerBoundKey(index.keys, hi + 1);
+    result.insert(result.end(), index.dates.begin() + first, index.dates.begin() + last);
+}
+
+// Диапазон одного запроса из пакета
+struct DateRange {
+    Date from;
+    Date to;
+};
+
+// Ответы на пакет запросов: даты запроса i лежат в matches[offsets[i], offsets[i + 1])
+struct BatchResult {
+    std::vector<Date> matches;
+    std::vector<size_t> offsets;
+};
+
+// Пакетный поиск за два прохода по датам для любого числа запросов.
+// Границы всех запросов делят ось ключей на элементарные интервалы; для каждого интервала
+// заранее известен список запросов, которые его покрывают. Дата находит свой интервал
+// бинарным поиском и попадает сразу во все эти запросы в исходном порядке
+void findDatesInRangesBatch(const std::vector<Date>& dates, const std::vector<DateRange>& ranges, BatchResult& result) {
+    size_t queries = ranges.size();
+
+    // Границы элементарных интервалов: начала запросов и позиции сразу после их концов
+    std::vector<uint64_t> bounds;
+    bounds.reserve(2 * queries);
+    for (const auto& range : ranges) {
+        uint64_t lo = packDate(range.from);
+        uint64_t hi = packDate(range.to);
+        if (lo > hi) continue;
+        bounds.push_back(lo);
+        bounds.push_back(hi + 1);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    // Для каждого интервала - список покрывающих его запросов (упакован по смещениям)
+    size_t intervals = bounds.empty() ? 0 : bounds.size() - 1;
+    std::vector<size_t> cover_offsets(intervals + 1, 0);
+    std::vector<std::pair<size_t, size_t>> spans(queries, {0, 0});
+    for (size_t q = 0; q < queries; ++q) {
+        uint64_t lo = packDate(ranges[q].from);
+        uint64_t hi = packDate(ranges[q].to);
+        if (lo > hi) continue;
+        size_t first = std::lower_bound(bounds.begin(), bounds.end(), lo) - bounds.begin();
+        size_t last = std::lower_bound(bounds.begin(), bounds.end(), hi + 1) - bounds.begin();
+        spans[q] = {first, last};
+        for (size_t j = first; j < last; ++j) {
+            ++cover_offsets[j + 1];
+        }
+    }
+    for (size_t j = 0; j < intervals; ++j) {
+        cover_offsets[j + 1] += cover_offsets[j];
+    }
+    std::vector<size_t> cover_queries(cover_offsets[intervals]);
+    std::vector<size_t> cover_fill(cover_offsets.begin(), cover_offsets.end() - 1);
+    for (size_t q = 0; q < queries; ++q) {
+        for (size_t j = spans[q].first; j < spans[q].second; ++j) {
+            cover_queries[cover_fill[j]++] = q;
+        }
+    }
+
+    // Номер интервала даты или intervals, если дата не входит ни в один запрос
+    auto intervalOf = [&](const Date& date) {
+        uint64_t key = packDate(date);
+        size_t pos = std::upper_bound(bounds.begin(), bounds.end(), key) - bounds.begin();
+        return (pos == 0 || pos > intervals) ? intervals : pos - 1;
+    };
+
+    // Первый проход: сколько дат попало в каждый интервал
+    std::vector<size_t> interval_counts(intervals + 1, 0);
+    for (const auto& date : dates) {
+        ++interval_counts[intervalOf(date)];
+    }
+
+    result.offsets.assign(queries + 1, 0);
+    for (size_t q = 0; q < queries; ++q) {
+        size_t found = 0;
+        for (size_t j = spans[q].first; j < spans[q].second; ++j) {
+            found += interval_counts[j];
+        }
+        result.offsets[q + 1] = result.offsets[q] + found;
+    }
+
+    // Второй проход: раскладываем даты по всем покрывающим запросам
+    result.matches.resize(result.offsets[queries]);
+    std::vector<size_t> cursors(result.offsets.begin(), result.offsets.end() - 1);
+    for (const auto& date : dates) {
+        size_t j = intervalOf(date);
+        if (j == intervals) continue;
+        for (size_t c = cover_offsets[j]; c < cover_offsets[j + 1]; ++c) {
+            result.matches[cursors[cover_queries[c]]++] = date;
+        }
+    }
+}
+
+// Пакетный поиск по индексу: концы запросов сортируются и сливаются с отсортированными
+// ключами за один проход, затем каждый ответ копируется непрерывным отрезком
+void findDatesInRangesBatch(const DateIndex& index, const std::vector<DateRange>& ranges, BatchResult& result) {
+    size_t queries = ranges.size();
+
+    // Концы запросов: ключ и куда записать найденную позицию (2q - начало, 2q + 1 - конец)
+    std::vector<std::pair<uint64_t, size_t>> endpoints;
+    endpoints.reserve(2 * queries);
+    for (size_t q = 0; q < queries; ++q) {
+        endpoints.emplace_back(packDate(ranges[q].from), 2 * q);
+        endpoints.emplace_back(static_cast<uint64_t>(packDate(ranges[q].to)) + 1, 2 * q + 1);
+    }
+    std::sort(endpoints.begin(), endpoints.end());
+
+    // Слияние: позиция только растёт, следующая ищется галопом от предыдущей
+    std::vector<size_t> positions(2 * queries);
+    const auto& keys = index.keys;
+    size_t pos = 0;
+    for (const auto& endpoint : endpoints) {
+        size_t step = 1;
+        size_t hi = pos;
+        while (hi < keys.size() && keys[hi] < endpoint.first) {
+            pos = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi, keys.size());
+        pos = std::lower_bound(keys.begin() + pos, keys.begin() + hi, endpoint.first,
+                               [](uint32_t key, uint64_t value) { return key < value; }) - keys.begin();
+        positions[endpoint.second] = pos;
+    }
+
+    result.offsets.assign(queries + 1, 0);
+    for (size_t q = 0; q < queries; ++q) {
+        size_t first = positions[2 * q];
+        size_t last = std::max(first, positions[2 * q + 1]);
+        result.offsets[q + 1] = result.offsets[q] + (last - first);
+    }
+
+    result.matches.resize(result.offsets[queries]);
+    for (size_t q = 0; q < queries; ++q) {
+        size_t first = positions[2 * q];
+        std::copy(index.dates.begin() + first,
+                  index.dates.begin() + first + (result.offsets[q + 1] - result.offsets[q]),
+                  result.matches.begin() + result.offsets[q]);
+    }
+}
+
+// Зональная карта: минимальный и максимальный ключ каждого блока дат и, по желанию,
+// битовая маска встречающихся в блоке месяцев (номер месяца от начала эры по модулю 64)
+struct DateZoneMap {
+    size_t block_size = 0;
+    std::vector<uint32_t> min_keys;
+    std::vector<uint32_t> max_keys;
+    std::vector<uint64_t> month_bits; // Пусто, если маски месяцев не строились
+};
+
+inline uint64_t monthBit(const Date& date) {
+    return 1ull << (static_cast<uint32_t>(date.year * 12 + date.month - 1) % 64);
+}
+
+DateZoneMap buildDateZoneMap(const std::vector<Date>& dates, size_t block_size = 4096, bool with_months = true) {
+    DateZoneMap zones;
+    zones.block_size = std::max<size_t>(1, block_size);
+    size_t blocks = (dates.size() + zones.block_size - 1) / zones.block_size;
+    zones.min_keys.assign(blocks, UINT32_MAX);
+    zones.max_keys.assign(blocks, 0);
+    if (with_months) zones.month_bits.assign(blocks, 0);
+
+    for (size_t i = 0; i < dates.size(); ++i) {
+        size_t block = i / zones.block_size;
+        uint32_t key = packDate(dates[i]);
+        zones.min_keys[block] = std::min(zones.min_keys[block], key);
+        zones.max_keys[block] = std::max(zones.max_keys[block], key);
+        if (with_months) zones.month_bits[block] |= monthBit(dates[i]);
+    }
+    return zones;
+}
+
+// Маска месяцев диапазона; если диапазон длиннее 64 месяцев, отсечь по ней нельзя
+uint64_t monthMask(const Date& d1, const Date& d2) {
+    long first = static_cast<long>(d1.year) * 12 + d1.month - 1;
+    long last = static_cast<long>(d2.year) * 12 + d2.month - 1;
+    if (last - first >= 63) return UINT64_MAX;
+    uint64_t mask = 0;
+    for (long month = first; month <= last; ++month) {
+        mask |= 1ull << (static_cast<uint32_t>(month) % 64);
+    }
+    return mask;
+}
+
+// Отношение блока к диапазону: не пересекается, пересекается частично или лежит целиком внутри
+enum class BlockMatch {
+    none,
+    partial,
+    full
+};
+
+BlockMatch classifyBlock(const DateZoneMap& zones, size_t block, uint32_t lo, uint32_t hi, uint64_t months) {
+    if (zones.max_keys[block] < lo || zones.min_keys[block] > hi) return BlockMatch::none;
+    if (zones.min_keys[block] >= lo && zones.max_keys[block] <= hi) return BlockMatch::full;
+    if (!zones.month_bits.empty() && (zones.month_bits[block] & months) == 0) return BlockMatch::none;
+    return BlockMatch::partial;
+}
+
+// Обработка блоков [first_block, last_block): пропуск, копирование целиком или построчная проверка
+void scanZonedBlocks(const std::vector<Date>& dates, const DateZoneMap& zones, size_t first_block, size_t last_block,
+                     const Date& d1, const Date& d2, uint64_t months, std::vector<Date>& result) {
+    uint32_t lo = packDate(d1);
+    uint32_t hi = packDate(d2);
+    for (size_t block = first_block; block < last_block; ++block) {
+        const Date* first = dates.data() + block * zones.block_size;
+        const Date* last = dates.data() + std::min(dates.size(), (block + 1) * zones.block_size);
+        switch (classifyBlock(zones, block, lo, hi, months)) {
+        case BlockMatch::none:
+            break;
+        case BlockMatch::full:
+            result.insert(result.end(), first, last);
+            break;
+        case BlockMatch::partial:
+            findDatesInRange(first, last, d1, d2, result);
+            break;
+        }
+    }
+}
+
+// Поиск с пропуском блоков по зональной карте; порядок результата как у findDatesInRange
+void findDatesInRangeZoned(const std::vector<Date>& dates, const DateZoneMap& zones, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    if (!(d1 <= d2)) return;
+    scanZonedBlocks(dates, zones, 0, zones.min_keys.size(), d1, d2, monthMask(d1, d2), result);
+}
+
+// Номер дня от 1900-01-01 по григорианскому календарю (для корректных дат)
+int32_t dayNumber(int year, int month, int day) {
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int year_of_era = y - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 693901; // 693901 - номер 1900-01-01 от 0000-03-01
+}
+
+int32_t dayNumber(const Date& date) {
+    return dayNumber(date.year, date.month, date.day);
+}
+
+Date dateFromDayNumber(int32_t days) {
+    int z = days + 693901;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int day_of_era = z - era * 146097;
+    int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int mp = (5 * day_of_year + 2) / 153;
+
+    Date date;
+    date.day = day_of_year - (153 * mp + 2) / 5 + 1;
+    date.month = mp < 10 ? mp + 3 : mp - 9;
+    date.year = year_of_era + era * 400 + (date.month <= 2);
+    return date;
+}
+
+int daysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return (month == 2 && leap) ? 29 : days[month - 1];
+}
+
+// Границы запроса могут быть некорректными датами (например, 31.02): берём первый
+// корректный день не раньше d1 и последний корректный день не позже d2
+int32_t lowerDayNumber(const Date& d1) {
+    if (d1.month < 1) return dayNumber(d1.year, 1, 1);
+    if (d1.month > 12) return dayNumber(d1.year + 1, 1, 1);
+    if (d1.day < 1) return dayNumber(d1.year, d1.month, 1);
+    if (d1.day > daysInMonth(d1.year, d1.month)) return dayNumber(d1.year, d1.month, daysInMonth(d1.year, d1.month)) + 1;
+    return dayNumber(d1);
+}
+
+int32_t upperDayNumber(const Date& d2) {
+    if (d2.month < 1) return dayNumber(d2.year, 1, 1) - 1;
+    if (d2.month > 12) return dayNumber(d2.year, 12, 31);
+    if (d2.day < 1) return dayNumber(d2.year, d2.month, 1) - 1;
+    return dayNumber(d2.year, d2.month, std::min(d2.day, daysInMonth(d2.year, d2.month)));
+}
+
+// Сжатый столбец дат: номера дней, упакованные поблочно. Блок хранит минимальный номер дня
+// и смещения от него минимальной ширины в битах. Для 1900-2100 (73 тыс. дней) это не больше
+// 17 бит на дату, а для дат, сгруппированных по времени, - заметно меньше.
+// В столбце хранятся только корректные даты
+struct PackedDateColumn {
+    static constexpr size_t block_size = 1024;
+
+    size_t count = 0;
+    std::vector<int32_t> base;     // Минимальный номер дня блока
+    std::vector<uint32_t> span;    // Наибольшее смещение в блоке
+    std::vector<uint8_t> width;    // Ширина смещений блока в битах
+    std::vector<size_t> offsets;   // Первое слово блока в words
+    std::vector<uint64_t> words;   // Упакованные смещения; в конце два слова запаса для чтения
+
+    size_t bytes() const {
+        return words.size() * sizeof(uint64_t) + base.size() * (sizeof(int32_t) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(size_t));
+    }
+
+    // Смещение j-й даты блока: читаем два соседних слова без ветвлений
+    uint32_t delta(size_t block, size_t j) const {
+        size_t bit = j * width[block];
+        const uint64_t* word = words.data() + offsets[block] + (bit >> 6);
+        unsigned shift = bit & 63;
+        uint64_t value = (word[0] >> shift) | ((word[1] << 1) << (63 - shift));
+        return static_cast<uint32_t>(value & ((uint64_t(1) << width[block]) - 1));
+    }
+
+    size_t blockRows(size_t block) const {
+        return std::min(block_size, count - block * block_size);
+    }
+};
+
+PackedDateColumn buildPackedDateColumn(const std::vector<Date>& dates) {
+    PackedDateColumn column;
+    column.count = dates.size();
+    size_t blocks = (dates.size() + PackedDateColumn::block_size - 1) / PackedDateColumn::block_size;
+    std::vector<int32_t> days(PackedDateColumn::block_size);
+
+    for (size_t block = 0; block < blocks; ++block) {
+        size_t first = block * PackedDateColumn::block_size;
+        size_t rows = std::min(PackedDateColumn::block_size, dates.size() - first);
+        int32_t lo = INT32_MAX;
+        int32_t hi = INT32_MIN;
+        for (size_t j = 0; j < rows; ++j) {
+            days[j] = dayNumber(dates[first + j]);
+            lo = std::min(lo, days[j]);
+            hi = std::max(hi, days[j]);
+        }
+
+        uint32_t span = static_cast<uint32_t>(hi - lo);
+        uint8_t width = 0;
+        while (width < 32 && (span >> width) != 0) {
+            ++width;
+        }
+
+        column.base.push_back(lo);
+        column.span.push_back(span);
+        column.width.push_back(width);
+        column.offsets.push_back(column.words.size());
+        size_t start = column.words.size();
+        column.words.resize(start + (rows * width + 63) / 64, 0);
+        for (size_t j = 0; j < rows && width > 0; ++j) {
+            uint64_t value = static_cast<uint32_t>(days[j] - lo);
+            size_t bit = j * width;
+            column.words[start + (bit >> 6)] |= value << (bit & 63);
+            if ((bit & 63) + width > 64) column.words[start + (bit >> 6) + 1] |= value >> (64 - (bit & 63));
+        }
+    }
+    column.words.resize(column.words.size() + 2, 0);
+    return column;
+}
+
+// Обработка блоков [first_block, last_block) сжатого столбца прямо по упакованным смещениям:
+// границы запроса переводятся в смещения блока, блоки вне диапазона пропускаются
+template <class OnMatch>
+void scanPackedBlocks(const PackedDateColumn& column, size_t first_block, size_t last_block, int32_t lo, int32_t hi, OnMatch&& on_match) {
+    for (size_t block = first_block; block < last_block; ++block) {
+        int64_t rel_lo = static_cast<int64_t>(lo) - column.base[block];
+        int64_t rel_hi = static_cast<int64_t>(hi) - column.base[block];
+        if (rel_hi < 0 || rel_lo > static_cast<int64_t>(column.span[block])) continue;
+
+        uint32_t from = static_cast<uint32_t>(std::max<int64_t>(rel_lo, 0));
+        uint32_t range = static_cast<uint32_t>(std::min<int64_t>(rel_hi, column.span[block])) - from;
+        size_t rows = column.blockRows(block);
+        for (size_t j = 0; j < rows; ++j) {
+            uint32_t delta = column.delta(block, j);
+            if ((delta - from) <= range) on_match(block, delta);
+        }
+    }
+}
+
+void findDatesInRange(const PackedDateColumn& column, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    int32_t lo = lowerDayNumber(d1);
+    int32_t hi = upperDayNumber(d2);
+    if (lo > hi) return;
+    scanPackedBlocks(column, 0, column.base.size(), lo, hi, [&](size_t block, uint32_t delta) {
+        result.push_back(dateFromDayNumber(column.base[block] + static_cast<int32_t>(delta)));
+    });
+}
+
+size_t countDatesInRange(const PackedDateColumn& column, const Date& d1, const Date& d2) {
+    int32_t lo = lowerDayNumber(d1);
+    int32_t hi = upperDayNumber(d2);
+    if (lo > hi) return 0;
+    size_t found = 0;
+    scanPackedBlocks(column, 0, column.base.size(), lo, hi, [&](size_t, uint32_t) { ++found; });
+    return found;
+}
+
+class DateSnapshot;
+
+// Хранилище дат только для дописывания. Даты лежат в сегментах фиксированного размера,
+// которые никогда не перемещаются и не освобождаются до уничтожения хранилища.
+// Писатели дописывают под своим мьютексом и публикуют новую длину; читатели берут снимок
+// (длину) без блокировок и видят все даты до неё, пока писатели продолжают дописывать
+class AppendableDateStore {
+public:
+    static constexpr size_t segment_size = 1 << 16;
+
+    explicit AppendableDateStore(size_t max_segments = 1 << 16)
+        : directory(new std::atomic<Date*>[max_segments])
+        , max_segments(max_segments)
+    {
+        for (size_t i = 0; i < max_segments; ++i) {
+            directory[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    AppendableDateStore(const AppendableDateStore&) = delete;
+    AppendableDateStore& operator=(const AppendableDateStore&) = delete;
+
+    void append(const Date* dates, size_t count) {
+        std::lock_guard<std::mutex> lock(write_mtx);
+        size_t length = published.load(std::memory_order_relaxed);
+        if (count > max_segments * segment_size - length) throw std::length_error("хранилище дат заполнено");
+        while (count > 0) {
+            size_t segment = length / segment_size;
+            size_t offset = length % segment_size;
+            if (offset == 0) addSegment(segment);
+
+            size_t n = std::min(count, segment_size - offset);
+            std::copy(dates, dates + n, directory[segment].load(std::memory_order_relaxed) + offset);
+            dates += n;
+            count -= n;
+            length += n;
+        }
+        // Публикация: после неё читатели видят и новые сегменты, и записанные даты
+        published.store(length, std::memory_order_release);
+    }
+
+    void append(const Date& date) {
+        append(&date, 1);
+    }
+
+    size_t size() const {
+        return published.load(std::memory_order_acquire);
+    }
+
+    DateSnapshot snapshot() const;
+
+private:
+    friend class DateSnapshot;
+
+    void addSegment(size_t segment) {
+        owned.emplace_back(new Date[segment_size]);
+        directory[segment].store(owned.back().get(), std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<std::atomic<Date*>[]> directory; // Адреса сегментов по номерам
+    size_t max_segments;
+    std::vector<std::unique_ptr<Date[]>> owned;      // Владение сегментами, только под write_mtx
+    std::mutex write_mtx;
+    std::atomic<size_t> published{0};                // Длина, видимая читателям
+};
+
+// Согласованный снимок хранилища: первые size() дат на момент взятия снимка
+class DateSnapshot {
+public:
+    DateSnapshot(const AppendableDateStore& store, size_t length)
+        : store(&store)
+        , length(length)
+    {}
+
+    size_t size() const {
+        return length;
+    }
+
+    size_t segments() const {
+        return (length + AppendableDateStore::segment_size - 1) / AppendableDateStore::segment_size;
+    }
+
+    // Непрерывный отрезок сегмента segment, попавший в снимок
+    const Date* segmentBegin(size_t segment) const {
+        return store->directory[segment].load(std::memory_order_relaxed);
+    }
+
+    const Date* segmentEnd(size_t segment) const {
+        return segmentBegin(segment) + std::min(AppendableDateStore::segment_size, length - segment * AppendableDateStore::segment_size);
+    }
+
+private:
+    const AppendableDateStore* store;
+    size_t length;
+};
+
+inline DateSnapshot AppendableDateStore::snapshot() const {
+    return DateSnapshot(*this, size());
+}
+
+void findDatesInRange(const DateSnapshot& snapshot, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    for (size_t segment = 0; segment < snapshot.segments(); ++segment) {
+        findDatesInRange(snapshot.segmentBegin(segment), snapshot.segmentEnd(segment), d1, d2, result);
+    }
+}
+
+// Потоковый поиск: совпадения выдаются пачками по мере просмотра, с ограничением
+// их общего числа и возможностью отмены из другого потока
+class DateRangeCursor {
+public:
+    DateRangeCursor(const Date* first, const Date* last, const Date& d1, const Date& d2,
+                    size_t limit = SIZE_MAX, const std::atomic<bool>* cancel = nullptr)
+        : current(first)
+        , last(last)
+        , d1(d1)
+        , d2(d2)
+        , remaining(limit)
+        , cancel(cancel)
+    {}
+
+    DateRangeCursor(const std::vector<Date>& dates, const Date& d1, const Date& d2,
+                    size_t limit = SIZE_MAX, const std::atomic<bool>* cancel = nullptr)
+        : DateRangeCursor(dates.data(), dates.data() + dates.size(), d1, d2, limit, cancel)
+    {}
+
+    // Следующая пачка, не больше batch_size дат. false - совпадений больше не будет:
+    // даты кончились, достигнут лимит или поиск отменён
+    bool next(std::vector<Date>& batch, size_t batch_size = 4096) {
+        batch.clear();
+        size_t wanted = std::min(batch_size, remaining);
+        while (batch.size() < wanted && current != last) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) {
+                current = last;
+                break;
+            }
+            // Флаг отмены проверяется раз на отрезок, а не на каждую дату
+            const Date* stop = current + std::min<size_t>(cancel_check_rows, last - current);
+            for (; current != stop && batch.size() < wanted; ++current) {
+                if (*current >= d1 && *current <= d2) {
+                    batch.push_back(*current);
+                }
+            }
+        }
+        remaining -= batch.size();
+        return !batch.empty();
+    }
+
+private:
+    static constexpr size_t cancel_check_rows = 4096;
+
+    const Date* current;
+    const Date* last;
+    Date d1;
+    Date d2;
+    size_t remaining;
+    const std::atomic<bool>* cancel;
+};
+
+// Двоичный файл столбца дат: 16-байтовый заголовок, затем записи Date подряд в порядке
+// байтов машины. Файл отображается в память как есть, без разбора при открытии
+struct DateFileHeader {
+    char magic[8];
+    uint64_t count;
+};
+
+const char date_file_magic[8] = {'D', 'A', 'T', 'E', 'C', 'O', 'L', '1'};
+
+void writeDateFile(const std::string& path, const std::vector<Date>& dates) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("не удалось создать файл " + path);
+
+    DateFileHeader header;
+    std::memcpy(header.magic, date_file_magic, sizeof(header.magic));
+    header.count = dates.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(dates.data()), dates.size() * sizeof(Date));
+    if (!file) throw std::runtime_error("ошибка записи в файл " + path);
+}
+
+// Файл дат, отображённый в память только для чтения; даты доступны без копирования
+class MappedDateFile {
+public:
+    explicit MappedDateFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("не удалось открыть " + path + ": " + std::strerror(errno));
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(DateFileHeader)) {
+            close(fd);
+            throw std::runtime_error("файл " + path + " слишком мал для заголовка");
+        }
+        mapping_size = static_cast<size_t>(info.st_size);
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd); // Отображение остаётся действительным и после закрытия дескриптора
+        if (mapping == MAP_FAILED) throw std::runtime_error("не удалось отобразить " + path + ": " + std::strerror(errno));
+
+        const auto* header = static_cast<const DateFileHeader*>(mapping);
+        if (std::memcmp(header->magic, date_file_magic, sizeof(header->magic)) != 0 ||
+            header->count > (mapping_size - sizeof(DateFileHeader)) / sizeof(Date)) {
+            munmap(mapping, mapping_size);
+            throw std::runtime_error("файл " + path + " не является столбцом дат");
+        }
+        count = header->count;
+    }
+
+    ~MappedDateFile() {
+        munmap(mapping, mapping_size);
+    }
+
+    MappedDateFile(const MappedDateFile&) = delete;
+    MappedDateFile& operator=(const MappedDateFile&) = delete;
+
+    const Date* data() const {
+        return reinterpret_cast<const Date*>(static_cast<const char*>(mapping) + sizeof(DateFileHeader));
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Подсказки ядру для потокового чтения: подгрузить отрезок заранее или отпустить прочитанный.
+    // Границы округляются внутрь до страниц, поэтому соседние отрезки не задеваются
+    void advise(size_t first, size_t last, int advice) const {
+        static const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t begin = reinterpret_cast<uintptr_t>(data() + first);
+        uintptr_t end = reinterpret_cast<uintptr_t>(data() + last);
+        begin = (begin + page - 1) & ~(page - 1);
+        end &= ~(page - 1);
+        if (begin < end) madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+    }
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    size_t count = 0;
+};
+
+// Размер отрезка потокового чтения файла: 1M записей (12 МБ)
+const size_t file_stream_chunk = 1 << 20;
+
+// Потоковый поиск по файлу: отрезок за отрезком, следующий подгружается заранее,
+// прочитанный отпускается, так что файл может быть больше оперативной памяти
+void findDatesInRange(const MappedDateFile& file, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    const Date* dates = file.data();
+    size_t count = file.size();
+    for (size_t begin = 0; begin < count; begin += file_stream_chunk) {
+        size_t end = std::min(count, begin + file_stream_chunk);
+        file.advise(end, std::min(count, end + file_stream_chunk), MADV_WILLNEED);
+        findDatesInRange(dates + begin, dates + end, d1, d2, result);
+        file.advise(begin, end, MADV_DONTNEED);
+    }
+}
+
+// Параллельный поиск по файлу: каждый поток сам читает свою часть отображения
+void findDatesInRangeParallel(const MappedDateFile& file, const Date& d1, const Date& d2, std::vector<Date>& result, int num_threads) {
+    file.advise(0, file.size(), MADV_SEQUENTIAL);
+    findDatesInRangeParallel(file.data(), file.size(), d1, d2, result, num_threads);
+}
+
+// Узел NUMA ядра по /sys; 0, если сведений нет (один узел или не Linux)
+int cpuNode(int cpu) {
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return 0;
+    int node = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = std::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+// Доступные процессу ядра, упорядоченные по узлам NUMA: потоки пула с соседними номерами
+// попадают на один узел, а непрерывные части массива - в память этого узла
+std::vector<int> cpusByNode() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    std::vector<std::pair<int, int>> cpus; // (узел, ядро)
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.emplace_back(cpuNode(cpu), cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+
+    std::vector<int> result;
+    for (const auto& cpu : cpus) {
+        result.push_back(cpu.second);
+    }
+    return result;
+}
+
+// Закрепить текущий поток за ядром
+void pinCurrentThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Пул постоянных потоков. Потоки создаются один раз и переиспользуются между запросами
+class ThreadPool {
+public:
+    // pin_threads - закрепить поток i за i-м ядром в порядке узлов NUMA (по кругу, если потоков больше)
+    explicit ThreadPool(size_t num_threads = std::max(1u, std::thread::hardware_concurrency()), bool pin_threads = false) {
+        if (pin_threads) cpus = cpusByNode();
+        for (size_t i = 0; i < std::max<size_t>(1, num_threads); ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // Выполнить job(worker) на каждом потоке пула и дождаться завершения всех
+    void run(const std::function<void(size_t)>& job) {
+        std::lock_guard<std::mutex> run_lock(run_mtx); // Один запрос к пулу за раз
+        std::unique_lock<std::mutex> lock(mtx);
+        current_job = &job;
+        pending = workers.size();
+        ++generation;
+        start_cv.notify_all();
+        done_cv.wait(lock, [this] { return pending == 0; });
+        current_job = nullptr;
+    }
+
+    // Обработать [0, count) кусками по grain элементов: fn(chunk, begin, end, worker).
+    // Каждый поток начинает со своей доли кусков, а закончив её, забирает куски у соседей,
+    // поэтому медленный поток не задерживает завершение
+    template <class Fn>
+    void parallelFor(size_t count, size_t grain, Fn&& fn) {
+        grain = std::max<size_t>(1, grain);
+        size_t chunks = (count + grain - 1) / grain;
+        size_t parts = workers.size();
+
+        std::vector<WorkRange> ranges(parts);
+        for (size_t i = 0; i < parts; ++i) {
+            ranges[i].next.store(chunks * i / parts, std::memory_order_relaxed);
+            ranges[i].end = chunks * (i + 1) / parts;
+        }
+
+        run([&](size_t worker) {
+            for (size_t k = 0; k < parts; ++k) {
+                WorkRange& range = ranges[(worker + k) % parts];
+                for (;;) {
+                    size_t chunk = range.next.fetch_add(1, std::memory_order_relaxed);
+                    if (chunk >= range.end) break;
+                    size_t begin = chunk * grain;
+                    fn(chunk, begin, std::min(count, begin + grain), worker);
+                }
+            }
+        });
+    }
+
+private:
+    // Доля кусков одного потока; выровнена, чтобы счётчики разных потоков не делили кэш-линию
+    struct alignas(64) WorkRange {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+
+    void workerLoop(size_t worker) {
+        if (!cpus.empty()) pinCurrentThread(cpus[worker % cpus.size()]);
+        size_t seen = 0;
+        for (;;) {
+            const std::function<void(size_t)>* job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                start_cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                job = current_job;
+            }
+
+            (*job)(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (--pending == 0) done_cv.notify_one();
+            }
+        }
+    }
+
+    std::vector<int> cpus; // Ядра для закрепления потоков; пусто - без закрепления
+    std::vector<std::thread> workers;
+    std::mutex run_mtx;
+    std::mutex mtx;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const std::function<void(size_t)>* current_job = nullptr;
+    size_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+};
+
+// Счётчик потока на отдельной кэш-линии
+struct alignas(64) PaddedCount {
+    size_t value = 0;
+};
+
+// Размер куска для пула: достаточно мелкий для балансировки, достаточно крупный для накладных расходов
+const size_t pool_grain = 1 << 16;
+
+// Параллельный поиск дат на пуле потоков; порядок результата совпадает с последовательным поиском
+void findDatesInRangePooled(ThreadPool& pool, const std::vector<Date>& dates, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    size_t chunks = (dates.size() + pool_grain - 1) / pool_grain;
+    std::vector<std::vector<Date>> partial_results(chunks);
+
+    pool.parallelFor(dates.size(), pool_grain, [&](size_t chunk, size_t begin, size_t end, size_t) {
+        for (size_t j = begin; j < end; ++j) {
+            if (dates[j] >= d1 && dates[j] <= d2) {
+                partial_results[chunk].push_back(dates[j]);
+            }
+        }
+    });
+
+    concatPartials(partial_results, result);
+}
+
+// Даты в буфере без инициализации: new Date[n] для агрегата Date не трогает память,
+// поэтому выделение не проходит по всему буферу, а каждый поток первым пишет свою часть
+struct DateBuffer {
+    std::unique_ptr<Date[]> dates;
+    size_t count = 0;
+
+    const Date* begin() const {
+        return dates.get();
+    }
+
+    const Date* end() const {
+        return dates.get() + count;
+    }
+};
+
+// Двухпроходный параллельный поиск: подсчёт совпадений по кускам, префиксная сумма,
+// затем каждый кусок пишет свои даты сразу на своё место в буфере точного размера
+void findDatesInRangeScatter(ThreadPool& pool, const std::vector<Date>& dates, const Date& d1, const Date& d2, DateBuffer& result) {
+    size_t chunks = (dates.size() + pool_grain - 1) / pool_grain;
+    std::vector<size_t> offsets(chunks + 1, 0);
+
+    pool.parallelFor(dates.size(), pool_grain, [&](size_t chunk, size_t begin, size_t end, size_t) {
+        size_t found = 0;
+        for (size_t j = begin; j < end; ++j) {
+            found += (dates[j] >= d1 && dates[j] <= d2);
+        }
+        offsets[chunk + 1] = found;
+    });
+
+    for (size_t i = 0; i < chunks; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    result.dates.reset(new Date[offsets[chunks]]);
+    result.count = offsets[chunks];
+    Date* out = result.dates.get();
+
+    pool.parallelFor(dates.size(), pool_grain, [&](size_t chunk, size_t begin, size_t end, size_t) {
+        Date* slot = out + offsets[chunk];
+        for (size_t j = begin; j < end; ++j) {
+            if (dates[j] >= d1 && dates[j] <= d2) {
+                *slot++ = dates[j];
+            }
+        }
+    });
+}
+
+// Параллельный поиск по сжатому столбцу на пуле: куски из целых блоков, результаты в исходном порядке
+void findDatesInRangeParallel(ThreadPool& pool, const PackedDateColumn& column, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    int32_t lo = lowerDayNumber(d1);
+    int32_t hi = upperDayNumber(d2);
+    if (lo > hi) return;
+    size_t blocks = column.base.size();
+    size_t grain = std::max<size_t>(1, pool_grain / PackedDateColumn::block_size);
+    std::vector<std::vector<Date>> partial_results((blocks + grain - 1) / grain);
+
+    pool.parallelFor(blocks, grain, [&](size_t chunk, size_t begin, size_t end, size_t) {
+        auto& part = partial_results[chunk];
+        scanPackedBlocks(column, begin, end, lo, hi, [&](size_t block, uint32_t delta) {
+            part.push_back(dateFromDayNumber(column.base[block] + static_cast<int32_t>(delta)));
+        });
+    });
+
+    concatPartials(partial_results, result);
+}
+
+// Параллельный поиск по снимку на пуле: кусок - несколько целых сегментов
+void findDatesInRangeParallel(ThreadPool& pool, const DateSnapshot& snapshot, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    size_t segments = snapshot.segments();
+    size_t grain = std::max<size_t>(1, pool_grain / AppendableDateStore::segment_size);
+    std::vector<std::vector<Date>> partial_results((segments + grain - 1) / grain);
+
+    pool.parallelFor(segments, grain, [&](size_t chunk, size_t begin, size_t end, size_t) {
+        for (size_t segment = begin; segment < end; ++segment) {
+            findDatesInRange(snapshot.segmentBegin(segment), snapshot.segmentEnd(segment), d1, d2, partial_results[chunk]);
+        }
+    });
+
+    concatPartials(partial_results, result);
+}
+
+// Размер куска для поиска с лимитом: мельче обычного, чтобы потоки быстрее останавливались
+const size_t limit_grain = 1 << 14;
+
+// Параллельный поиск первых limit дат (в исходном порядке). Куски выдаются строго по порядку
+// из общего счётчика, поэтому взятые куски всегда образуют начало массива; как только
+// найдено limit дат или поиск отменён, потоки перестают брать новые куски
+void findDatesInRangeParallelLimit(ThreadPool& pool, const std::vector<Date>& dates, const Date& d1, const Date& d2,
+                                   size_t limit, std::vector<Date>& result, const std::atomic<bool>* cancel = nullptr) {
+    if (limit == 0) return;
+    size_t chunks = (dates.size() + limit_grain - 1) / limit_grain;
+    std::vector<std::vector<Date>> partial_results(chunks);
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> found{0};
+
+    pool.run([&](size_t) {
+        for (;;) {
+            if (found.load(std::memory_order_relaxed) >= limit) return;
+            if (cancel && cancel->load(std::memory_order_relaxed)) return;
+            size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunks) return;
+
+            // Больше limit дат из одного куска не понадобится
+            auto& part = partial_results[chunk];
+            size_t end = std::min(dates.size(), (chunk + 1) * limit_grain);
+            for (size_t j = chunk * limit_grain; j < end && part.size() < limit; ++j) {
+                if (dates[j] >= d1 && dates[j] <= d2) {
+                    part.push_back(dates[j]);
+                }
+            }
+            found.fetch_add(part.size(), std::memory_order_relaxed);
+        }
+    });
+
+    size_t taken = 0;
+    for (const auto& part : partial_results) {
+        size_t n = std::min(part.size(), limit - taken);
+        result.insert(result.end(), part.begin(), part.begin() + n);
+        taken += n;
+        if (taken == limit) break;
+    }
+}
+
+// Массив дат, разложенный по потокам пула: часть i выделяется без инициализации и впервые
+// записывается потоком i. При политике первого касания её страницы оказываются на узле NUMA
+// этого потока, и поиск по той же части тем же потоком читает только локальную память.
+// Пул должен быть с закреплёнными потоками и одним и тем же для заполнения и поиска
+class FirstTouchDates {
+public:
+    // Копия source, разложенная по узлам
+    FirstTouchDates(ThreadPool& pool, const std::vector<Date>& source)
+        : count(source.size())
+        , parts(pool.size())
+        , dates(new Date[source.size()])
+    {
+        pool.run([&](size_t worker) {
+            std::copy(source.data() + partBegin(worker), source.data() + partEnd(worker), dates.get() + partBegin(worker));
+        });
+    }
+
+    // Случайные даты, сгенерированные сразу на месте (те же, что даёт generateRandomDates)
+    FirstTouchDates(ThreadPool& pool, size_t count, uint64_t seed)
+        : count(count)
+        , parts(pool.size())
+        , dates(new Date[count])
+    {
+        pool.run([&](size_t worker) {
+            fillRandomDates(dates.get(), partBegin(worker), partEnd(worker), seed);
+        });
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    const Date* data() const {
+        return dates.get();
+    }
+
+    size_t partBegin(size_t part) const {
+        return count * part / parts;
+    }
+
+    size_t partEnd(size_t part) const {
+        return count * (part + 1) / parts;
+    }
+
+private:
+    size_t count;
+    size_t parts;
+    std::unique_ptr<Date[]> dates;
+};
+
+// Поиск с привязкой к узлам: поток i просматривает ровно ту часть, которую сам заполнил.
+// Перехвата кусков здесь нет намеренно - он увёл бы поток в память чужого узла
+void findDatesInRangeLocal(ThreadPool& pool, const FirstTouchDates& dates, const Date& d1, const Date& d2, std::vector<Date>& result) {
+    std::vector<std::vector<Date>> partial_results(pool.size());
+    pool.run([&](size_t worker) {
+        findDatesInRange(dates.data() + dates.partBegin(worker), dates.data() + dates.partEnd(worker), d1, d2, partial_results[worker]);
+    });
+
+    concatPartials(partial_results, result);
+}
+
+// Параллельный подсчёт: каждый поток копит свою сумму, суммы складываются в конце
+size_t countDatesInRangeParallel(ThreadPool& pool, const std::vector<Date>& dates, const Date& d1, const Date& d2) {
+    std::vector<PaddedCount> partial_counts(pool.size());
+    pool.parallelFor(dates.size(), pool_grain, [&](size_t, size_t begin, size_t end, size_t worker) {
+        partial_counts[worker].value += countDatesInRange(dates.data() + begin, dates.data() + end, d1, d2);
+    });
+
+    size_t total = 0;
+    for (const auto& part : partial_counts) {
+        total += part.value;
+    }
+    return total;
+}
+
+// Параллельная гистограмма: своя гистограмма у каждого потока, сложение в конце
+DateHistogram histogramDatesInRangeParallel(ThreadPool& pool, const std::vector<Date>& dates, const Date& d1, const Date& d2) {
+    std::vector<DateHistogram> partial_histograms(pool.size(), makeHistogram(d1, d2));
+    pool.parallelFor(dates.size(), pool_grain, [&](size_t, size_t begin, size_t end, size_t worker) {
+        addToHistogram(dates.data() + begin, dates.data() + end, d1, d2, partial_histograms[worker]);
+    });
+
+    DateHistogram histogram = makeHistogram(d1, d2);
+    for (const auto& part : partial_histograms) {
+        for (size_t i = 0; i < histogram.counts.size(); ++i) {
+            histogram.counts[i] += part.counts[i];
+        }
+    }
+    return histogram;
+}
+
+// Параллельный поиск по зональной карте на пуле: куски из целых блоков, результаты в исходном порядке
+void findDatesInRangeZonedParallel(ThreadPool& pool, const std::vector<Date>& dates, const DateZoneMap& zones,
+                                   const Date& d1, const Date& d2, std::vector<Date>& result) {
+    if (!(d1 <= d2)) return;
+    size_t blocks = zones.min_keys.size();
+    size_t grain = std::max<size_t>(1, pool_grain / zones.block_size);
+    std::vector<std::vector<Date>> partial_results((blocks + grain - 1) / grain);
+    uint64_t months = monthMask(d1, d2);
+
+    pool.parallelFor(blocks, grain, [&](size_t chunk, size_t begin, size_t end, size_t) {
+        scanZonedBlocks(dates, zones, begin, end, d1, d2, months, partial_results[chunk]);
+    });
+
+    concatPartials(partial_results, result);
+}
+
+// Поиск по файлу дат: файл создаётся при первом запуске, дальше только отображается
+int searchDateFile(const std::string& path, size_t data_size, int num_threads, const Date& d1, const Date& d2) {
+    if (access(path.c_str(), F_OK) != 0) {
+        std::vector<Date> dates(data_size);
+        generateRandomDates(dates, randomSeed(), num_threads);
+        writeDateFile(path, dates);
+    }
+
+    auto start_open = std::chrono::high_resolution_clock::now();
+    MappedDateFile file(path);
+    auto end_open = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_open = end_open - start_open;
+
+    auto start_single = std::chrono::high_resolution_clock::now();
+    std::vector<Date> result_single;
+    findDatesInRange(file, d1, d2, result_single);
+    auto end_single = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_single = end_single - start_single;
+
+    auto start_multi = std::chrono::high_resolution_clock::now();
+    std::vector<Date> result_multi;
+    findDatesInRangeParallel(file, d1, d2, result_multi, num_threads);
+    auto end_multi = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_multi = end_multi - start_multi;
+
+    std::cout << "Файл " << path << ": " << file.size() << " дат, открытие " << elapsed_open.count() << " секунд.\n";
+    std::cout << "Однопоточная обработка файла: " << elapsed_single.count() << " секунд, найдено " << result_single.size() << " дат.\n";
+    std::cout << "Многопоточная обработка файла: " << elapsed_multi.count() << " секунд, найдено " << result_multi.size() << " дат.\n";
+    return 0;
+}
+
+// Параметры замеров: каждый список перебирается полностью, по одному замеру на сочетание
+struct BenchOptions {
+    std::vector<size_t> sizes{10000000};
+    std::vector<int> threads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+    std::vector<double> selectivities{0.01, 0.1, 0.5};
+    int warmup = 1;        // Прогревочных запусков, в статистику не входят
+    int repeats = 5;       // Измеряемых запусков
+    uint64_t seed = 42;    // Данные одинаковы от запуска к запуску
+    std::string format = "text"; // text, csv или json
+};
+
+// Итог одного способа поиска на одном сочетании параметров
+struct BenchRecord {
+    std::string method;
+    size_t size;
+    int threads;
+    double selectivity; // Фактическая доля найденных дат
+    size_t found;
+    double median;
+    double p95;
+    double min;
+    double mean;
+    bool correct;       // Результат совпал с однопоточным поиском
+};
+
+// Список значений через запятую
+template <class T>
+std::vector<T> parseList(const std::string& text) {
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::stringstream parser(item);
+        T value;
+        if (!(parser >> value) || !parser.eof()) throw std::runtime_error("неверное значение в списке: " + item);
+        values.push_back(value);
+    }
+    if (values.empty()) throw std::runtime_error("пустой список значений");
+    return values;
+}
+
+// Разбор параметров вида --name=value, начиная с argv[first]
+BenchOptions parseBenchOptions(int argc, char* argv[], int first) {
+    BenchOptions options;
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) throw std::runtime_error("ожидается --параметр=значение: " + arg);
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+
+        if (name == "sizes") options.sizes = parseList<size_t>(value);
+        else if (name == "threads") options.threads = parseList<int>(value);
+        else if (name == "selectivity") options.selectivities = parseList<double>(value);
+        else if (name == "warmup") options.warmup = parseList<int>(value).front();
+        else if (name == "repeats") options.repeats = parseList<int>(value).front();
+        else if (name == "seed") options.seed = parseList<uint64_t>(value).front();
+        else if (name == "format") options.format = value;
+        else throw std::runtime_error("неизвестный параметр: " + name);
+    }
+
+    for (int threads : options.threads) {
+        if (threads < 1) throw std::runtime_error("число потоков должно быть положительным");
+    }
+    for (double selectivity : options.selectivities) {
+        if (selectivity < 0 || selectivity > 1) throw std::runtime_error("доля выборки должна быть от 0 до 1");
+    }
+    if (options.repeats < 1 || options.warmup < 0) throw std::runtime_error("неверное число запусков");
+    if (options.format != "text" && options.format != "csv" && options.format != "json") throw std::runtime_error("формат должен быть text, csv или json");
+    return options;
+}
+
+// Диапазон, в который попадает заданная доля дат: отрезок вокруг медианы отсортированных ключей
+void rangeForSelectivity(const DateIndex& index, double selectivity, Date& d1, Date& d2) {
+    size_t n = index.keys.size();
+    size_t width = static_cast<size_t>(selectivity * n);
+    if (n == 0 || width == 0) {
+        d1 = {2, 1, 1};
+        d2 = {1, 1, 1}; // Пустой диапазон
+        return;
+    }
+    size_t first = (n - width) / 2;
+    d1 = index.dates[first];
+    d2 = index.dates[first + width - 1];
+}
+
+// Времена запусков в секундах после прогрева
+template <class Fn>
+std::vector<double> timeRuns(int warmup, int repeats, Fn&& fn) {
+    for (int i = 0; i < warmup; ++i) {
+        fn();
+    }
+    std::vector<double> times;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    return times;
+}
+
+// Статистика по запускам: медиана и 95-й перцентиль по ближайшему рангу
+void fillStats(std::vector<double> times, BenchRecord& record) {
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    record.min = times.front();
+    record.median = (n % 2) ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+    record.p95 = times[std::min(n - 1, static_cast<size_t>(std::ceil(0.95 * n)) - 1)];
+    double sum = 0;
+    for (double t : times) {
+        sum += t;
+    }
+    record.mean = sum / n;
+}
+
+bool sameDates(const Date* first, const Date* last, const std::vector<Date>& b) {
+    if (static_cast<size_t>(last - first) != b.size()) return false;
+    for (size_t i = 0; i < b.size(); ++i) {
+        if (packDate(first[i]) != packDate(b[i])) return false;
+    }
+    return true;
+}
+
+bool sameDates(const std::vector<Date>& a, const std::vector<Date>& b) {
+    return sameDates(a.data(), a.data() + a.size(), b);
+}
+
+// Выравнивание текста по ширине в символах, а не в байтах UTF-8
+std::string padText(const std::string& text, size_t width, bool left = false) {
+    size_t chars = 0;
+    for (unsigned char c : text) {
+        chars += (c & 0xC0) != 0x80;
+    }
+    std::string padding(chars < width ? width - chars : 0, ' ');
+    return left ? text + padding : padding + text;
+}
+
+void printBenchRecords(const std::vector<BenchRecord>& records, const std::string& format) {
+    if (format == "csv") {
+        std::cout << "method,size,threads,selectivity,found,median_s,p95_s,min_s,mean_s,correct\n";
+        for (const auto& r : records) {
+            std::cout << r.method << ',' << r.size << ',' << r.threads << ',' << r.selectivity << ',' << r.found << ','
+                      << r.median << ',' << r.p95 << ',' << r.min << ',' << r.mean << ',' << (r.correct ? "true" : "false") << '\n';
+        }
+    } else if (format == "json") {
+        std::cout << "[\n";
+        for (size_t i = 0; i < records.size(); ++i) {
+            const auto& r = records[i];
+            std::cout << "  {\"method\": \"" << r.method << "\", \"size\": " << r.size << ", \"threads\": " << r.threads
+                      << ", \"selectivity\": " << r.selectivity << ", \"found\": " << r.found
+                      << ", \"median_s\": " << r.median << ", \"p95_s\": " << r.p95 << ", \"min_s\": " << r.min
+                      << ", \"mean_s\": " << r.mean << ", \"correct\": " << (r.correct ? "true" : "false") << "}"
+                      << (i + 1 < records.size() ? ",\n" : "\n");
+        }
+        std::cout << "]\n";
+    } else {
+        std::cout << padText("способ", 16, true) << padText("дат", 11) << padText("потоки", 8) << padText("доля", 9)
+                  << padText("найдено", 11) << padText("медиана, с", 12) << padText("p95, с", 12) << "  проверка\n";
+        for (const auto& r : records) {
+            std::cout << std::left << std::setw(16) << r.method << std::right << std::setw(11) << r.size << std::setw(8) << r.threads
+                      << std::setw(9) << std::setprecision(3) << r.selectivity << std::setw(11) << r.found
+                      << std::setw(12) << std::setprecision(4) << r.median << std::setw(12) << r.p95
+                      << "  " << (r.correct ? "ok" : "ОШИБКА") << '\n';
+        }
+    }
+}
+
+// Замеры всех способов поиска по сетке размер x потоки x доля выборки.
+// Однопоточный поиск служит эталоном: результаты остальных способов сверяются с ним
+// Диапазон одной доли выборки и эталон для него - результат однопоточного поиска
+struct BenchCase {
+    double selectivity; // Фактическая доля найденных дат
+    Date d1;
+    Date d2;
+    std::vector<Date> expected;
+};
+
+// Все даты результата лежат в диапазоне, и их не больше limit
+bool datesWithinLimit(const std::vector<Date>& result, const Date& d1, const Date& d2, size_t limit) {
+    if (result.size() > limit) return false;
+    for (const auto& date : result) {
+        if (!(date >= d1 && date <= d2)) return false;
+    }
+    return true;
+}
+
+int runBenchmark(const BenchOptions& options) {
+    SimdLevel simd_level = detectSimdLevel();
+    std::vector<BenchRecord> records;
+    const size_t limit = 100; // Для поиска первых совпадений
+
+    for (size_t size : options.sizes) {
+        int max_threads = *std::max_element(options.threads.begin(), options.threads.end());
+        std::vector<Date> dates(size);
+        generateRandomDates(dates, options.seed, max_threads);
+        DateColumn column = buildDateColumn(dates);
+        DateIndex index = buildDateIndexParallel(dates, max_threads);
+        DateZoneMap zones = buildDateZoneMap(dates);
+        DateZoneMap sorted_zones = buildDateZoneMap(index.dates);
+        PackedDateColumn packed = buildPackedDateColumn(dates);
+        AppendableDateStore store((size + AppendableDateStore::segment_size - 1) / AppendableDateStore::segment_size + 1);
+        store.append(dates.data(), dates.size());
+        DateSnapshot snapshot = store.snapshot();
+
+        std::vector<BenchCase> cases;
+        for (double selectivity : options.selectivities) {
+            BenchCase c;
+            rangeForSelectivity(index, selectivity, c.d1, c.d2);
+            findDatesInRange(dates, c.d1, c.d2, c.expected);
+            c.selectivity = size ? static_cast<double>(c.expected.size()) / size : 0;
+            cases.push_back(std::move(c));
+        }
+
+        // Способ, который возвращает даты; expected - с чем сравнить результат
+        auto benchDates = [&](const std::string& method, int threads, const BenchCase& c, const std::vector<Date>& expected, auto&& search) {
+            BenchRecord record{method, size, threads, c.selectivity, 0, 0, 0, 0, 0, true};
+            std::vector<Date> result;
+            auto times = timeRuns(options.warmup, options.repeats, [&] {
+                result.clear();
+                search(result);
+            });
+            record.found = result.size();
+            record.correct = sameDates(result, expected);
+            fillStats(times, record);
+            records.push_back(record);
+        };
+        // Способ, который пишет даты в буфер без инициализации
+        auto benchBuffer = [&](const std::string& method, int threads, const BenchCase& c, auto&& search) {
+            BenchRecord record{method, size, threads, c.selectivity, 0, 0, 0, 0, 0, true};
+            DateBuffer result;
+            auto times = timeRuns(options.warmup, options.repeats, [&] { search(result); });
+            record.found = result.count;
+            record.correct = sameDates(result.begin(), result.end(), c.expected);
+            fillStats(times, record);
+            records.push_back(record);
+        };
+        // Способ, который возвращает только число дат
+        auto benchCount = [&](const std::string& method, int threads, const BenchCase& c, auto&& count) {
+            BenchRecord record{method, size, threads, c.selectivity, 0, 0, 0, 0, 0, true};
+            auto times = timeRuns(options.warmup, options.repeats, [&] { record.found = count(); });
+            record.correct = record.found == c.expected.size();
+            fillStats(times, record);
+            records.push_back(record);
+        };
+        // Первые limit совпадений: годится любой набор дат из диапазона нужного размера
+        auto benchLimit = [&](const std::string& method, int threads, const BenchCase& c, auto&& search) {
+            BenchRecord record{method, size, threads, c.selectivity, 0, 0, 0, 0, 0, true};
+            std::vector<Date> result;
+            auto times = timeRuns(options.warmup, options.repeats, [&] {
+                result.clear();
+                search(result);
+            });
+            record.found = result.size();
+            record.correct = result.size() == std::min(limit, c.expected.size()) && datesWithinLimit(result, c.d1, c.d2, limit);
+            fillStats(times, record);
+            records.push_back(record);
+        };
+
+        // Однопоточные способы от числа потоков не зависят и замеряются один раз
+        for (const auto& c : cases) {
+            const Date& d1 = c.d1;
+            const Date& d2 = c.d2;
+            benchDates("serial", 1, c, c.expected, [&](std::vector<Date>& r) { findDatesInRange(dates, d1, d2, r); });
+            benchDates("columnar", 1, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeColumnar(column, d1, d2, r, simd_level); });
+            benchDates("zoned", 1, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeZoned(dates, zones, d1, d2, r); });
+            benchCount("count_simd", 1, c, [&] { return countDatesInRange(column, d1, d2, simd_level); });
+            benchDates("packed", 1, c, c.expected, [&](std::vector<Date>& r) { findDatesInRange(packed, d1, d2, r); });
+            benchCount("count_packed", 1, c, [&] { return countDatesInRange(packed, d1, d2); });
+            benchDates("snapshot", 1, c, c.expected, [&](std::vector<Date>& r) { findDatesInRange(snapshot, d1, d2, r); });
+            benchLimit("cursor", 1, c, [&](std::vector<Date>& r) {
+                DateRangeCursor cursor(dates, d1, d2, limit);
+                std::vector<Date> batch;
+                while (cursor.next(batch, 32)) {
+                    r.insert(r.end(), batch.begin(), batch.end());
+                }
+            });
+
+            // Упорядоченные способы сверяются с отсортированным последовательным результатом,
+            // а не с индексом, чтобы проверка покрывала и построение индекса, и поиск по нему
+            std::vector<Date> expected_sorted = c.expected;
+            std::sort(expected_sorted.begin(), expected_sorted.end(),
+                      [](const Date& a, const Date& b) { return packDate(a) < packDate(b); });
+            benchDates("indexed", 1, c, expected_sorted, [&](std::vector<Date>& r) { findDatesInRangeIndexed(index, d1, d2, r); });
+            benchDates("zoned_sorted", 1, c, expected_sorted, [&](std::vector<Date>& r) { findDatesInRangeZoned(index.dates, sorted_zones, d1, d2, r); });
+        }
+
+        // Пакет узких запросов (месяц случайной даты из набора): один проход по датам против
+        // слияния с индексом. Способы независимы и сверяются друг с другом по числу совпадений
+        if (size > 0) {
+            std::mt19937_64 generator(options.seed);
+            std::vector<DateRange> ranges(1000);
+            for (auto& range : ranges) {
+                Date month = dates[generator() % size];
+                range.from = {1, month.month, month.year};
+                range.to = {31, month.month, month.year};
+            }
+            BatchResult result_batch, result_indexed;
+            auto times_batch = timeRuns(options.warmup, options.repeats, [&] { findDatesInRangesBatch(dates, ranges, result_batch); });
+            auto times_indexed = timeRuns(options.warmup, options.repeats, [&] { findDatesInRangesBatch(index, ranges, result_indexed); });
+            bool same = result_batch.offsets == result_indexed.offsets;
+            double share = static_cast<double>(result_batch.matches.size()) / size;
+            BenchRecord batch{"batch", size, 1, share, result_batch.matches.size(), 0, 0, 0, 0, same};
+            BenchRecord batch_indexed{"batch_indexed", size, 1, share, result_indexed.matches.size(), 0, 0, 0, 0, same};
+            fillStats(times_batch, batch);
+            fillStats(times_indexed, batch_indexed);
+            records.push_back(batch);
+            records.push_back(batch_indexed);
+        }
+
+        // Пулы и копия дат на узлах потоков создаются один раз на число потоков
+        for (int threads : options.threads) {
+            ThreadPool pool(threads);
+            ThreadPool pinned_pool(threads, true);
+            FirstTouchDates local_dates(pinned_pool, dates);
+            for (const auto& c : cases) {
+                const Date& d1 = c.d1;
+                const Date& d2 = c.d2;
+                benchDates("parallel", threads, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeParallel(dates, d1, d2, r, threads); });
+                benchDates("pooled", threads, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangePooled(pool, dates, d1, d2, r); });
+                benchBuffer("scatter", threads, c, [&](DateBuffer& r) { findDatesInRangeScatter(pool, dates, d1, d2, r); });
+                benchDates("zoned_pool", threads, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeZonedParallel(pool, dates, zones, d1, d2, r); });
+                benchDates("packed_pool", threads, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeParallel(pool, packed, d1, d2, r); });
+                benchDates("snapshot_pool", threads, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeParallel(pool, snapshot, d1, d2, r); });
+                benchDates("local_pinned", threads, c, c.expected, [&](std::vector<Date>& r) { findDatesInRangeLocal(pinned_pool, local_dates, d1, d2, r); });
+                benchCount("count_pool", threads, c, [&] { return countDatesInRangeParallel(pool, dates, d1, d2); });
+                benchCount("histogram", threads, c, [&] {
+                    DateHistogram histogram = histogramDatesInRangeParallel(pool, dates, d1, d2);
+                    size_t total = 0;
+                    for (size_t n : histogram.counts) {
+                        total += n;
+                    }
+                    return total;
+                });
+                benchLimit("limit_pool", threads, c, [&](std::vector<Date>& r) { findDatesInRangeParallelLimit(pool, dates, d1, d2, limit, r); });
+            }
+        }
+    }
+
+    printBenchRecords(records, options.format);
+
+    for (const auto& record : records) {
+        if (!record.correct) {
+            std::cerr << "Результат способа " << record.method << " не совпал с однопоточным поиском\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Параметры
+    size_t data_size = 10000000; // Размер массива данных
+    int num_threads = std::max(1u, std::thread::hardware_concurrency()); // Количество потоков по числу ядер
+    Date d1 = {1, 1, 2000};    // Начало диапазона
+    Date d2 = {31, 12, 2020};  // Конец диапазона
+    uint64_t seed = randomSeed(); // Фиксированное значение даёт воспроизводимый набор дат
+
+    // Сравнение всех способов поиска:
+    // n2 --bench [--sizes=... --threads=... --selectivity=... --warmup=N --repeats=N --seed=N --format=text|csv|json]
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        try {
+            return runBenchmark(parseBenchOptions(argc, argv, 2));
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // С аргументом - путь к файлу дат: поиск идёт прямо по отображению файла
+    if (argc > 1) {
+        try {
+            return searchDateFile(argv[1], data_size, num_threads, d1, d2);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Генерация массива дат
+    std::vector<Date> dates(data_size);
+    generateRandomDates(dates, seed, num_threads);
+
+    // Однопоточная обработка
+    auto start_single = std::chrono::high_resolution_clock::now();
+    std::vector<Date> result_single;
+    findDatesInRange(dates, d1, d2, result_single);
+    auto end_single = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_single = end_single - start_single;
+
+    // Многопоточная обработка
+    auto start_multi = std::chrono::high_resolution_clock::now();
+    std::vector<Date> result_multi;
+    findDatesInRangeParallel(dates, d1, d2, result_multi, num_threads);
+    auto end_multi = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_multi = end_multi - start_multi;
+
+    // Вывод результатов
+    std::cout << "Однопоточная обработка: " << elapsed_single.count() << " секунд, найдено " << result_single.size() << " дат.\n";
+    std::cout << "Многопоточная обработка: " << elapsed_multi.count() << " секунд, найдено " << result_multi.size() << " дат.\n";
+
+    return 0;
+}
@@ -5,6 +5,19 @@
 #include <vector>
 #include <chrono>
 #include <random>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include <deque>
+#include <functional>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+#include <cmath>
+#include "logger.h"
 using namespace std;
 using namespace std::chrono;
 
@@ -13,129 +26,987 @@ enum class Type {
     writer
 };
 
-Type priority = Type::reader; // Приоритет: читатели или писатели
+// Политика приоритета блокировки
+enum class Policy {
+    reader, // Читатели не ждут, пока есть ожидающие писатели
+    writer, // Новые читатели ждут, пока есть ожидающие писатели
+    fair    // Чередование фаз: после каждой записи входят все читатели, ждавшие её окончания
+};
+
+Policy priority = Policy::reader; // Приоритет: читатели, писатели или чередование фаз
+
+// Блокировка читателей-писателей с раздельными очередями ожидания.
+// Читатели и писатели ждут на разных условных переменных, и каждое освобождение будит
+// только тех, кто сможет войти: одного писателя или всех допущенных читателей
+class SharedLock {
+public:
+    explicit SharedLock(Policy policy = Policy::reader)
+        : policy(policy)
+    {}
+
+    // Смена политики; допустима, только пока блокировкой никто не пользуется
+    void setPolicy(Policy newPolicy) {
+        lock_guard<mutex> lock(mtx);
+        policy = newPolicy;
+    }
+
+    // Захват на чтение. Ожидающий читатель запоминает номер фазы записи, в которую встал
+    // в очередь: при политике fair его пускает конец этой записи, а не раздача пропусков,
+    // которую мог бы перехватить читатель, пришедший позже
+    void lock_shared() {
+        unique_lock<mutex> lock(mtx);
+        if (!canEnterRead()) {
+            ++readersWait;
+            unsigned phase = writePhase;
+            readersCv.wait(lock, [&] { return canReadQueued(phase); });
+            --readersWait;
+            // Читатель, допущенный концом своей фазы записи, расходует свой пропуск
+            if (phase != writePhase && readersPass > 0) --readersPass;
+        }
+        ++readersCnt;
+    }
+
+    void unlock_shared() {
+        unique_lock<mutex> lock(mtx);
+        --readersCnt;
+        // Последний читатель передаёт ресурс одному писателю
+        if (readersCnt == 0 && writersWait != 0) {
+            lock.unlock();
+            writersCv.notify_one();
+        }
+    }
+
+    // Захват на запись
+    void lock() {
+        unique_lock<mutex> lock(mtx);
+        if (!canWrite()) {
+            ++writersWait;
+            writersCv.wait(lock, [this] { return canWrite(); });
+            --writersWait;
+        }
+        writing = true;
+    }
+
+    void unlock() {
+        unique_lock<mutex> lock(mtx);
+        writing = false;
+        ++writePhase;
+
+        bool wakeReaders = false;
+        switch (policy) {
+        case Policy::writer:
+            wakeReaders = writersWait == 0;
+            break;
+        case Policy::reader:
+            wakeReaders = readersWait != 0;
+            break;
+        case Policy::fair:
+            // Фаза чтения: пропуск получают все читатели, ждавшие окончания этой записи;
+            // все они встали в очередь до смены writePhase
+            wakeReaders = readersWait != 0;
+            readersPass = readersWait;
+            break;
+        }
+        lock.unlock();
 
-mutex mtx;                   // Мьютекс для синхронизации доступа
-condition_variable cv;       // Условная переменная для ожидания потоков
+        if (wakeReaders) {
+            readersCv.notify_all();
+        } else {
+            writersCv.notify_one();
+        }
+    }
+
+private:
+    // Условия входа проверяются под mtx.
+    // Новый читатель при политике fair не входит, пока есть ожидающие писатели: он ждёт
+    // следующей фазы чтения и не занимает пропуск тех, кто ждал окончания текущей записи
+    bool canEnterRead() const {
+        if (writing) return false;
+        if (policy == Policy::reader) return true;
+        return writersWait == 0;
+    }
 
-int readersCnt = 0;          // Количество активных читателей
-bool writing = false;        // Флаг записи (true, если идет запись)
+    // Читатель, вставший в очередь в фазе записи phase
+    bool canReadQueued(unsigned phase) const {
+        if (writing) return false;
+        switch (policy) {
+        case Policy::reader:
+            return true;
+        case Policy::writer:
+            return writersWait == 0;
+        case Policy::fair:
+            return writersWait == 0 || phase != writePhase;
+        }
+        return true;
+    }
+
+    bool canWrite() const {
+        if (writing || readersCnt != 0) return false;
+        if (policy == Policy::reader && readersWait != 0) return false;
+        if (policy == Policy::fair && readersPass != 0) return false;
+        return true;
+    }
 
-int writersWait = 0;         // Количество ожидающих писателей
-int readersWait = 0;         // Количество ожидающих читателей
+    mutex mtx;                    // Мьютекс состояния блокировки
+    condition_variable readersCv; // Очередь ожидающих читателей
+    condition_variable writersCv; // Очередь ожидающих писателей
+    Policy policy;
+
+    int readersCnt = 0;          // Количество активных читателей
+    bool writing = false;        // Флаг записи (true, если идет запись)
+    int readersWait = 0;         // Количество ожидающих читателей
+    int writersWait = 0;         // Количество ожидающих писателей
+    int readersPass = 0;         // Пропуски в текущую фазу чтения (политика fair)
+    unsigned writePhase = 0;     // Число завершённых записей; делит ожидающих читателей на фазы
+};
+
+// Блокировка для нагрузки, где почти все операции - чтения (по схеме BRAVO).
+// Пока включён уклон в сторону чтения, читатель только увеличивает счётчик своего слота
+// (у каждого слота своя кэш-линия) и не трогает общих данных. Писатель захватывает
+// обычную SharedLock, выключает уклон и ждёт, пока опустеют все слоты. После такой
+// смены уклон какое-то время не включается обратно, чтобы частые писатели не платили
+// за просмотр слотов каждый раз
+class DistributedSharedLock {
+public:
+    using ReadToken = size_t; // Слот быстрого чтения или slowRead
+
+    static constexpr ReadToken slowRead = SIZE_MAX;
+
+    explicit DistributedSharedLock(Policy policy = Policy::reader, size_t slotsCnt = 2 * max(1u, thread::hardware_concurrency()))
+        : underlying(policy)
+        , slotsCnt(slotsCnt)
+        , slots(new Slot[slotsCnt])
+    {}
+
+    void setPolicy(Policy policy) {
+        underlying.setPolicy(policy);
+    }
+
+    ReadToken lock_shared() {
+        if (readBias.load(memory_order_acquire)) {
+            size_t slot = threadSlot() % slotsCnt;
+            slots[slot].readers.fetch_add(1, memory_order_seq_cst);
+            // Писатель мог выключить уклон между проверкой и отметкой в слоте
+            if (readBias.load(memory_order_seq_cst)) {
+                return slot;
+            }
+            slots[slot].readers.fetch_sub(1, memory_order_release);
+        }
+
+        underlying.lock_shared();
+        // Под блокировкой чтения писателей нет, и уклон можно безопасно вернуть
+        if (!readBias.load(memory_order_relaxed) && steadyNow() >= inhibitUntil.load(memory_order_relaxed)) {
+            readBias.store(true, memory_order_seq_cst);
+        }
+        return slowRead;
+    }
+
+    void unlock_shared(ReadToken token) {
+        if (token == slowRead) {
+            underlying.unlock_shared();
+        } else {
+            slots[token].readers.fetch_sub(1, memory_order_release);
+        }
+    }
+
+    void lock() {
+        underlying.lock();
+        if (readBias.load(memory_order_relaxed)) {
+            auto start = steadyNow();
+            readBias.store(false, memory_order_seq_cst);
+            for (size_t i = 0; i < slotsCnt; ++i) {
+                while (slots[i].readers.load(memory_order_seq_cst) != 0) {
+                    this_thread::yield();
+                }
+            }
+            // Окно без уклона в inhibitFactor раз длиннее, чем заняла смена уклона
+            inhibitUntil.store(steadyNow() + (steadyNow() - start) * inhibitFactor, memory_order_relaxed);
+        }
+    }
+
+    void unlock() {
+        underlying.unlock();
+    }
 
-int allThreads = 0;          // Общее количество активных потоков
+private:
+    struct alignas(64) Slot {
+        atomic<int> readers{0};
+    };
+
+    static constexpr int64_t inhibitFactor = 9;
+
+    static int64_t steadyNow() {
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Потоки получают номера по кругу, так что соседние потоки попадают в разные слоты
+    static size_t threadSlot() {
+        static atomic<size_t> nextSlot{0};
+        thread_local size_t slot = nextSlot.fetch_add(1, memory_order_relaxed);
+        return slot;
+    }
+
+    SharedLock underlying;             // Медленный путь читателей и все писатели
+    size_t slotsCnt;
+    unique_ptr<Slot[]> slots;          // Индикаторы быстрых читателей
+    atomic<bool> readBias{true};       // Разрешено ли быстрое чтение
+    atomic<int64_t> inhibitUntil{0};   // Раньше этого момента уклон не включается
+};
+
+// Последовательная блокировка (seqlock) для небольших значений. Читатель ничего не пишет
+// в общую память: он сверяет счётчик версий до и после чтения и повторяет чтение, если за
+// это время прошла запись. Писатели не ждут читателей, только друг друга.
+// Значение хранится в атомарных словах, поэтому одновременное чтение и запись не гонка
+template <class T>
+class SeqLock {
+    static_assert(is_trivially_copyable<T>::value, "SeqLock хранит только тривиально копируемые значения");
+
+public:
+    explicit SeqLock(const T& initial = T()) {
+        storeWords(initial);
+    }
+
+    // Оптимистичное чтение; work выполняется внутри читающей секции и повторяется вместе с ней
+    template <class Work>
+    T read(Work&& work) const {
+        for (;;) {
+            unsigned before = version.load(memory_order_acquire);
+            if (before & 1) { // Идёт запись
+                this_thread::yield();
+                continue;
+            }
+            T value = loadWords();
+            work();
+            atomic_thread_fence(memory_order_acquire);
+            if (version.load(memory_order_relaxed) == before) {
+                return value;
+            }
+        }
+    }
+
+    T read() const {
+        return read([] {});
+    }
+
+    // Запись: нечётная версия на время записи, читатели в это время повторяют чтение
+    template <class Work>
+    void write(const T& value, Work&& work) {
+        unsigned current = version.load(memory_order_relaxed);
+        for (;;) {
+            if (!(current & 1) && version.compare_exchange_weak(current, current + 1, memory_order_acquire)) {
+                break;
+            }
+            this_thread::yield();
+            current = version.load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_release);
+        storeWords(value);
+        work();
+        version.store(current + 2, memory_order_release);
+    }
+
+    void write(const T& value) {
+        write(value, [] {});
+    }
+
+private:
+    static constexpr size_t wordsCnt = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    T loadWords() const {
+        uint64_t raw[wordsCnt];
+        for (size_t i = 0; i < wordsCnt; ++i) {
+            raw[i] = words[i].load(memory_order_relaxed);
+        }
+        T value;
+        memcpy(&value, raw, sizeof(T));
+        return value;
+    }
+
+    void storeWords(const T& value) {
+        uint64_t raw[wordsCnt] = {};
+        memcpy(raw, &value, sizeof(T));
+        for (size_t i = 0; i < wordsCnt; ++i) {
+            words[i].store(raw[i], memory_order_relaxed);
+        }
+    }
+
+    atomic<unsigned> version{0}; // Нечётная - идёт запись
+    atomic<uint64_t> words[wordsCnt];
+};
+
+// Объединение записей (group commit). Писатель ставит запрос в очередь; первый, кто застал
+// очередь без комбайнера, забирает весь накопленный пакет и применяет его за одну
+// исключительную фазу, остальные писатели ждут отметки о выполнении своего запроса.
+// Читатели видят одно окно записи на пакет, а не на каждого писателя
+class WriteCombiner {
+public:
+    struct Request {
+        int value;
+        function<void()> work; // Работа писателя внутри исключительной фазы
+        bool done = false;
+    };
+
+    // commit(batch) выполняет пакет запросов под исключительной блокировкой
+    template <class Commit>
+    void submit(Request& request, Commit&& commit) {
+        unique_lock<mutex> lock(mtx);
+        pending.push_back(&request);
+        while (!request.done) {
+            if (combining) {
+                doneCv.wait(lock);
+                continue;
+            }
+            combining = true;
+            vector<Request*> batch;
+            batch.swap(pending);
+            lock.unlock();
+            commit(batch);
+            lock.lock();
+            for (auto* r : batch) {
+                r->done = true;
+            }
+            combining = false;
+            ++batchesCnt;
+            doneCv.notify_all();
+        }
+    }
+
+    // Сколько исключительных фаз понадобилось всем записям
+    size_t batches() {
+        lock_guard<mutex> lock(mtx);
+        return batchesCnt;
+    }
+
+private:
+    mutex mtx;
+    condition_variable doneCv; // Пакет применён или комбайнер освободился
+    vector<Request*> pending;
+    bool combining = false;
+    size_t batchesCnt = 0;
+};
+
+// Хранилище ключ -> значение, разбитое на шарды со своей блокировкой читателей-писателей.
+// Операции над ключами разных шардов не конкурируют; шард выровнен по кэш-линии, чтобы
+// соседние блокировки не делили её между ядрами. Операция над несколькими ключами берёт
+// блокировки шардов в порядке их номеров, поэтому две такие операции не зациклятся
+class ShardedStore {
+public:
+    ShardedStore(size_t shardsCnt, Policy policy = Policy::reader)
+        : shardsCnt(shardsCnt)
+        , shards(new Shard[shardsCnt])
+    {
+        for (size_t i = 0; i < shardsCnt; ++i) {
+            shards[i].lock.setPolicy(policy);
+        }
+    }
+
+    // Чтение ключа; work выполняется под блокировкой шарда. false - ключа нет
+    template <class Work>
+    bool get(uint64_t key, int& value, Work&& work) {
+        Shard& shard = shardOf(key);
+        shard.lock.lock_shared();
+        auto it = shard.data.find(key);
+        bool found = it != shard.data.end();
+        if (found) value = it->second;
+        work();
+        shard.lock.unlock_shared();
+        return found;
+    }
+
+    bool get(uint64_t key, int& value) {
+        return get(key, value, [] {});
+    }
+
+    template <class Work>
+    void put(uint64_t key, int value, Work&& work) {
+        Shard& shard = shardOf(key);
+        shard.lock.lock();
+        shard.data[key] = value;
+        work();
+        shard.lock.unlock();
+    }
+
+    void put(uint64_t key, int value) {
+        put(key, value, [] {});
+    }
+
+    // Атомарное изменение нескольких ключей: work(values) получает указатели на значения
+    // в порядке keys (отсутствующие ключи создаются с нулём). Ключи могут повторяться
+    template <class Work>
+    void updateMany(const vector<uint64_t>& keys, Work&& work) {
+        vector<size_t> order;
+        for (auto key : keys) {
+            order.push_back(shardIndex(key));
+        }
+        sort(order.begin(), order.end());
+        order.erase(unique(order.begin(), order.end()), order.end());
+
+        for (auto i : order) {
+            shards[i].lock.lock();
+        }
+        vector<int*> values;
+        for (auto key : keys) {
+            values.push_back(&shardOf(key).data[key]);
+        }
+        work(values);
+        for (auto i = order.rbegin(); i != order.rend(); ++i) {
+            shards[*i].lock.unlock();
+        }
+    }
+
+    size_t size() const {
+        return shardsCnt;
+    }
+
+private:
+    struct alignas(64) Shard {
+        SharedLock lock;
+        unordered_map<uint64_t, int> data;
+    };
+
+    // Перемешивание ключа, чтобы соседние ключи расходились по разным шардам
+    size_t shardIndex(uint64_t key) const {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key % shardsCnt;
+    }
+
+    Shard& shardOf(uint64_t key) {
+        return shards[shardIndex(key)];
+    }
+
+    size_t shardsCnt;
+    unique_ptr<Shard[]> shards;
+};
+
+// Вид блокировки общего ресурса
+enum class LockKind {
+    shared,      // SharedLock
+    distributed, // DistributedSharedLock
+    seqlock      // SeqLock: оптимистичные читатели, писатели не ждут читателей
+};
+
+LockKind lockKind = LockKind::shared; // Какая блокировка защищает sharedData
+bool combineWrites = false;           // Писатели объединяют записи через combiner
+
+SharedLock rwLock(priority); // Блокировка общего ресурса
+DistributedSharedLock distributedLock(priority); // Она же для нагрузки из одних чтений
 
 int sharedData = 10;         // Общий ресурс
+SeqLock<int> seqData(10);    // Тот же ресурс для оптимистичного режима (lockKind == seqlock)
+WriteCombiner combiner;      // Очередь записей для режима combineWrites
+atomic<size_t> exclusivePhases{0}; // Сколько раз писатели забирали ресурс себе
 
-// Генерация случайного числа в диапазоне [a, b]
+// Генерация случайного числа в диапазоне [a, b]; у каждого потока свой генератор
 size_t rnd(size_t a = 0, size_t b = INT32_MAX) {
-    static auto now = system_clock::now().time_since_epoch().count();
-    static default_random_engine generator(now);
-    static uniform_int_distribution<size_t> distribution(0, UINT64_MAX);
+    thread_local default_random_engine generator(system_clock::now().time_since_epoch().count() ^ hash<thread::id>()(this_thread::get_id()));
+    thread_local uniform_int_distribution<size_t> distribution(0, UINT64_MAX);
 
     return a + distribution(generator) % (b - a);
 }
 
-// Поток читателя
-void reader(int id) {
-    {
+// Защёлка завершения: ожидающий поток спит, пока счётчик не дойдёт до нуля
+class Latch {
+public:
+    explicit Latch(size_t count)
+        : count(count)
+    {}
+
+    void countDown() {
+        lock_guard<mutex> lock(mtx);
+        if (count > 0 && --count == 0) {
+            cv.notify_all();
+        }
+    }
+
+    void wait() {
         unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [this] { return count == 0; });
+    }
 
-        // Ждать, если идет запись
-        if (writing) {
-            ++readersWait;
-            cv.wait(lock, [&] { return !writing; });
-            --readersWait;
+private:
+    mutex mtx;
+    condition_variable cv;
+    size_t count;
+};
+
+// Пул рабочих потоков с ограниченной очередью задач. Если очередь заполнена,
+// submit ждёт, пока рабочие потоки не разберут часть задач
+class Executor {
+public:
+    Executor(size_t workersCnt, size_t capacity)
+        : capacity(max<size_t>(1, capacity))
+    {
+        for (size_t i = 0; i < max<size_t>(1, workersCnt); ++i) {
+            workers.emplace_back(&Executor::workerLoop, this);
         }
+    }
 
-        // Ждать, если приоритет у писателей
-        if (readersCnt == 0 && priority == Type::writer && writersWait != 0) {
-            ++readersWait;
-            cv.wait(lock, [&] {
-                return !writing && writersWait == 0;
-            });
-            --readersWait;
+    // Потоки завершаются, выполнив все уже поставленные задачи
+    ~Executor() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        notEmpty.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
         }
+    }
 
-        // Увеличиваем счетчик активных читателей
-        ++readersCnt;
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void submit(function<void()> task) {
+        {
+            unique_lock<mutex> lock(mtx);
+            notFull.wait(lock, [this] { return tasks.size() < capacity; });
+            tasks.push_back(move(task));
+        }
+        notEmpty.notify_one();
     }
 
-    // Читатель выполняет чтение
-    this_thread::sleep_for(std::chrono::milliseconds(rnd(10, 1000)));
+private:
+    void workerLoop() {
+        for (;;) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(mtx);
+                notEmpty.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = move(tasks.front());
+                tasks.pop_front();
+            }
+            notFull.notify_one();
+            task();
+        }
+    }
 
-    {
-        unique_lock<mutex> lock(mtx);
-        cout << "Читатель " << id << " прочитал: " << sharedData << endl;
+    mutex mtx;
+    condition_variable notEmpty; // Появилась задача или пул останавливается
+    condition_variable notFull;  // В очереди освободилось место
+    deque<function<void()>> tasks;
+    size_t capacity;
+    bool stopping = false;
+    vector<thread> workers;
+};
 
-        // Уменьшаем счетчик активных читателей
-        --readersCnt;
+// Чтение общего ресурса под выбранной блокировкой; work имитирует работу внутри чтения
+template <class Work>
+int readSharedData(Work&& work) {
+    int value;
+    if (lockKind == LockKind::seqlock) {
+        value = seqData.read(work);
+    } else if (lockKind == LockKind::distributed) {
+        auto token = distributedLock.lock_shared();
+        value = sharedData;
+        work();
+        distributedLock.unlock_shared(token);
+    } else {
+        rwLock.lock_shared();
+        value = sharedData;
+        work();
+        rwLock.unlock_shared();
+    }
+    return value;
+}
 
-        // Уведомляем потоки, если больше нет читателей
-        if (readersCnt == 0) {
-            cv.notify_all();
-        }
+// Одна исключительная фаза под выбранной блокировкой; work имитирует работу внутри записи
+template <class Work>
+void writeExclusive(int value, Work&& work) {
+    exclusivePhases.fetch_add(1, memory_order_relaxed);
+    if (lockKind == LockKind::seqlock) {
+        seqData.write(value, work);
+    } else if (lockKind == LockKind::distributed) {
+        distributedLock.lock();
+        sharedData = value;
+        work();
+        distributedLock.unlock();
+    } else {
+        rwLock.lock();
+        sharedData = value;
+        work();
+        rwLock.unlock();
+    }
+}
 
-        --allThreads; // Уменьшаем общее количество потоков
+// Запись общего ресурса. В режиме combineWrites запись уходит в пакет: значения пакета
+// записываются по порядку, так что в итоге остаётся последнее, а работа всех писателей
+// пакета выполняется в одной исключительной фазе
+template <class Work>
+void writeSharedData(int value, Work&& work) {
+    if (!combineWrites) {
+        writeExclusive(value, work);
+        return;
     }
+    WriteCombiner::Request request{value, ref(work)};
+    combiner.submit(request, [](const vector<WriteCombiner::Request*>& batch) {
+        writeExclusive(batch.back()->value, [&] {
+            for (auto* r : batch) {
+                sharedData = r->value;
+                r->work();
+            }
+        });
+    });
+}
+
+// Поток читателя
+void reader(int id) {
+    // Читатель выполняет чтение
+    int value = readSharedData([] {
+        this_thread::sleep_for(std::chrono::milliseconds(rnd(10, 1000)));
+    });
+
+    logLine("Читатель ", id, " прочитал: ", value);
 }
 
 // Поток писателя
 void writer(int id) {
+    // Писатель выполняет запись
+    int value = rnd();
+    writeSharedData(value, [&] {
+        logLine("Писатель ", id, " записал: ", value);
+        this_thread::sleep_for(std::chrono::milliseconds(rnd(10, 1000)));
+    });
+}
+
+// Параметры нагрузочного теста блокировки
+struct BenchConfig {
+    int readers = 3;            // Потоков, которые только читают
+    int writers = 1;            // Потоков, которые только пишут
+    int64_t durationMs = 1000;  // Длина окна измерения
+    int64_t csNs = 200;         // Длина критической секции, нс активной работы
+    int64_t thinkNs = 0;        // Пауза между операциями, нс активной работы
+    Policy policy = Policy::reader;
+    LockKind lock = LockKind::shared;
+    bool combine = false;       // Объединять записи в пакеты
+    size_t shards = 0;          // Шардов в ShardedStore; 0 - один общий sharedData
+    size_t keys = 1 << 16;      // Ключей в хранилище
+    double zipf = 0;            // Показатель распределения Ципфа; 0 - равномерные ключи
+    double multiRatio = 0;      // Доля записей, переносящих значение между двумя ключами
+};
+
+// Генератор ключей [0, keysCnt): равномерный или по закону Ципфа, где ключ k выбирается
+// с вероятностью, пропорциональной 1 / (k + 1)^s. Для Ципфа хранится таблица накопленных
+// вероятностей, ключ находится двоичным поиском
+class KeyGenerator {
+public:
+    KeyGenerator(size_t keysCnt, double s)
+        : keysCnt(keysCnt)
     {
-        unique_lock<mutex> lock(mtx);
+        if (s <= 0) return;
+        cdf.resize(keysCnt);
+        double sum = 0;
+        for (size_t k = 0; k < keysCnt; ++k) {
+            sum += 1 / pow(double(k + 1), s);
+            cdf[k] = sum;
+        }
+        for (auto& c : cdf) {
+            c /= sum;
+        }
+    }
 
-        // Ждать, если кто-то пишет или читает
-        if (writing || readersCnt != 0 || (priority == Type::reader && readersWait != 0)) {
-            ++writersWait;
+    uint64_t next() const {
+        if (cdf.empty()) return rnd(0, keysCnt);
+        double u = rnd(0, 1 << 30) / double(1 << 30);
+        return min<size_t>(lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), keysCnt - 1);
+    }
 
-            cv.wait(lock, [&] {
-                if (priority == Type::reader && readersWait != 0) {
-                    return false;
-                }
-                return !writing && readersCnt == 0;
-            });
+private:
+    size_t keysCnt;
+    vector<double> cdf;
+};
 
-            --writersWait;
+// Активная работа заданной длительности: в отличие от sleep_for, поток не уходит с ядра
+void spinFor(int64_t ns) {
+    if (ns <= 0) return;
+    auto deadline = steady_clock::now() + nanoseconds(ns);
+    while (steady_clock::now() < deadline) {
+    }
+}
+
+// Перцентиль по ближайшему рангу; values отсортирован
+int64_t percentile(const vector<int64_t>& values, double p) {
+    if (values.empty()) return 0;
+    size_t rank = static_cast<size_t>(p * values.size() + 0.999999);
+    return values[min(values.size(), max<size_t>(1, rank)) - 1];
+}
+
+// Индекс справедливости Джейна: (сумма)^2 / (n * сумма квадратов). 1 - все продвигаются
+// одинаково, 1/n - работает один
+double jainIndex(const vector<double>& rates) {
+    double sum = 0, sumSquares = 0;
+    for (double rate : rates) {
+        sum += rate;
+        sumSquares += rate * rate;
+    }
+    return sumSquares > 0 ? sum * sum / (rates.size() * sumSquares) : 1.0;
+}
+
+// Итоги одного класса потоков: скорость, ожидание захвата в микросекундах и справедливость
+// внутри класса. Пустые waits означают, что потоки класса ни разу не вошли
+void printClass(const string& name, vector<vector<int64_t>>& waits, double seconds) {
+    vector<int64_t> all;
+    vector<double> rates;
+    for (auto& w : waits) {
+        all.insert(all.end(), w.begin(), w.end());
+        rates.push_back(w.size() / seconds);
+    }
+    sort(all.begin(), all.end());
+    cout << name << ", потоков " << waits.size() << ": " << all.size() << " операций, " << fixed << setprecision(0)
+         << all.size() / seconds << " оп/с" << defaultfloat << setprecision(6) << ", ожидание p50 "
+         << percentile(all, 0.5) / 1000.0 << " мкс, p95 " << percentile(all, 0.95) / 1000.0 << " мкс, p99 "
+         << percentile(all, 0.99) / 1000.0 << " мкс, максимум " << (all.empty() ? 0 : all.back()) / 1000.0
+         << " мкс, справедливость " << jainIndex(rates) << "\n";
+}
+
+// Нагрузочный тест: отдельные потоки-читатели и потоки-писатели работают в общем окне
+// заданной длины. Ожидание операции - её время минус длина критической секции (для
+// seqlock сюда входят и повторы чтения). Справедливость - индекс Джейна по скорости
+// потоков: общий и внутри каждого класса. При политике reader писатели заметно отстают
+// от читателей, при writer - наоборот
+int runBenchmark(const BenchConfig& config) {
+    priority = config.policy;
+    lockKind = config.lock;
+    combineWrites = config.combine;
+    exclusivePhases = 0;
+    rwLock.setPolicy(config.policy);
+    distributedLock.setPolicy(config.policy);
+
+    // В режиме шардов операции идут в хранилище, заполненное заранее
+    unique_ptr<ShardedStore> store;
+    KeyGenerator keys(config.keys, config.zipf);
+    if (config.shards > 0) {
+        store.reset(new ShardedStore(config.shards, config.policy));
+        for (size_t k = 0; k < config.keys; ++k) {
+            store->put(k, 0);
         }
+    }
 
-        // Начинаем запись
-        writing = true;
+    int threadsCnt = config.readers + config.writers;
+    vector<vector<int64_t>> waits(threadsCnt); // Первые readers - читатели
+    atomic<bool> stop{false};
+    Latch ready(threadsCnt + 1);
+    vector<thread> threads;
+
+    for (int t = 0; t < threadsCnt; ++t) {
+        threads.emplace_back([&, t] {
+            bool isReader = t < config.readers;
+            auto work = [&] { spinFor(config.csNs); };
+            ready.countDown();
+            ready.wait();
+            for (size_t i = 0; !stop.load(memory_order_relaxed); ++i) {
+                auto opStart = steady_clock::now();
+                if (store) {
+                    int value;
+                    if (isReader) {
+                        store->get(keys.next(), value, work);
+                    } else if (rnd(0, 1000000) < config.multiRatio * 1000000) {
+                        store->updateMany({keys.next(), keys.next()}, [&](vector<int*>& values) {
+                            --*values[0];
+                            ++*values[1];
+                            work();
+                        });
+                    } else {
+                        store->put(keys.next(), static_cast<int>(i), work);
+                    }
+                } else if (isReader) {
+                    readSharedData(work);
+                } else {
+                    writeSharedData(static_cast<int>(i), work);
+                }
+                int64_t elapsed = duration_cast<nanoseconds>(steady_clock::now() - opStart).count();
+                waits[t].push_back(max<int64_t>(0, elapsed - config.csNs));
+                spinFor(config.thinkNs);
+            }
+        });
     }
 
-    // Писатель выполняет запись
-    sharedData = rnd();
-    cout << "Писатель " << id << " записал: " << sharedData << endl;
-    this_thread::sleep_for(std::chrono::milliseconds(rnd(10, 1000)));
+    // Окно открывается, когда все потоки созданы, и закрывается по таймеру
+    ready.countDown();
+    ready.wait();
+    auto start = steady_clock::now();
+    this_thread::sleep_for(milliseconds(config.durationMs));
+    stop = true;
+    for (auto& th : threads) {
+        th.join();
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
 
-    {
-        unique_lock<mutex> lock(mtx);
+    vector<vector<int64_t>> readWaits(waits.begin(), waits.begin() + config.readers);
+    vector<vector<int64_t>> writeWaits(waits.begin() + config.readers, waits.end());
+    vector<double> rates;
+    size_t opsCnt = 0, writesCnt = 0;
+    for (int t = 0; t < threadsCnt; ++t) {
+        rates.push_back(waits[t].size() / seconds);
+        opsCnt += waits[t].size();
+        if (t >= config.readers) writesCnt += waits[t].size();
+    }
 
-        // Завершаем запись
-        writing = false;
-        cv.notify_all(); // Уведомляем потоки
+    cout << "Окно " << seconds << " с: " << opsCnt << " операций, " << fixed << setprecision(0) << opsCnt / seconds
+         << " оп/с" << defaultfloat << setprecision(6) << "\n";
+    printClass("Читатели", readWaits, seconds);
+    printClass("Писатели", writeWaits, seconds);
+    if (!store) {
+        size_t phases = exclusivePhases.load();
+        cout << "Исключительных фаз: " << phases << ", " << fixed << setprecision(0) << phases / seconds << " в секунду"
+             << defaultfloat << setprecision(3) << ", записей на фазу " << (phases ? double(writesCnt) / phases : 0.0)
+             << setprecision(6) << "\n";
+    }
+    cout << "Индекс справедливости по всем потокам: " << jainIndex(rates) << "\n";
+    return 0;
+}
+
+// Разбор параметров вида --name=value; бросает invalid_argument при ошибке
+BenchConfig parseBenchConfig(int argc, char* argv[], int first) {
+    BenchConfig config;
+    for (int i = first; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == string::npos) throw invalid_argument("ожидается --параметр=значение: " + arg);
+        string name = arg.substr(2, eq - 2);
+        string value = arg.substr(eq + 1);
+
+        if (name == "readers") config.readers = stoi(value);
+        else if (name == "writers") config.writers = stoi(value);
+        else if (name == "duration-ms") config.durationMs = stoll(value);
+        else if (name == "cs-ns") config.csNs = stoll(value);
+        else if (name == "think-ns") config.thinkNs = stoll(value);
+        else if (name == "combine") config.combine = stoi(value) != 0;
+        else if (name == "shards") config.shards = stoull(value);
+        else if (name == "keys") config.keys = stoull(value);
+        else if (name == "zipf") config.zipf = stod(value);
+        else if (name == "multi-ratio") config.multiRatio = stod(value);
+        else if (name == "policy") {
+            if (value == "reader") config.policy = Policy::reader;
+            else if (value == "writer") config.policy = Policy::writer;
+            else if (value == "fair") config.policy = Policy::fair;
+            else throw invalid_argument("политика должна быть reader, writer или fair");
+        } else if (name == "lock") {
+            if (value == "shared") config.lock = LockKind::shared;
+            else if (value == "distributed") config.lock = LockKind::distributed;
+            else if (value == "seqlock") config.lock = LockKind::seqlock;
+            else throw invalid_argument("блокировка должна быть shared, distributed или seqlock");
+        } else throw invalid_argument("неизвестный параметр: " + name);
+    }
+    if (config.readers < 0 || config.writers < 0 || config.readers + config.writers < 1) {
+        throw invalid_argument("нужен хотя бы один поток, числа потоков неотрицательны");
+    }
+    if (config.durationMs <= 0) throw invalid_argument("длина окна должна быть положительной");
+    if (config.multiRatio < 0 || config.multiRatio > 1) throw invalid_argument("доля переносов должна быть от 0 до 1");
+    if (config.shards > 0 && config.keys == 0) throw invalid_argument("в хранилище должен быть хотя бы один ключ");
+    if (config.shards > 0 && (config.lock != LockKind::shared || config.combine)) {
+        throw invalid_argument("шарды защищены SharedLock: --lock и --combine с ними не используются");
+    }
+    return config;
+}
+
+// Проверка порядка фаз политики fair. Писатель W1 держит блокировку, читатель R1 ждёт
+// её окончания, за ним встаёт писатель W2. Сразу после освобождения W1 приходит новый
+// читатель R2. R1 должен войти раньше W2, а R2 - ждать следующей фазы чтения.
+// Возвращает 0, если порядок соблюдён во всех повторах
+int checkFairOrdering(int rounds = 20) {
+    for (int round = 0; round < rounds; ++round) {
+        SharedLock lock(Policy::fair);
+        mutex orderMtx;
+        string order;
+        auto record = [&](const char* who) {
+            lock_guard<mutex> guard(orderMtx);
+            order += who;
+        };
+
+        lock.lock(); // W1
+        thread r1([&] {
+            lock.lock_shared();
+            record("R1 ");
+            this_thread::sleep_for(milliseconds(20));
+            lock.unlock_shared();
+        });
+        this_thread::sleep_for(milliseconds(10));
+        thread w2([&] {
+            lock.lock();
+            record("W2 ");
+            lock.unlock();
+        });
+        this_thread::sleep_for(milliseconds(10));
 
-        --allThreads; // Уменьшаем общее количество потоков
+        lock.unlock();
+        lock.lock_shared(); // R2
+        record("R2 ");
+        lock.unlock_shared();
+
+        r1.join();
+        w2.join();
+        if (order.find("R1") > order.find("W2") || order.find("W2") > order.find("R2")) {
+            cerr << "Нарушен порядок фаз (повтор " << round << "): " << order << "\n";
+            return 1;
+        }
     }
+    cout << "Порядок фаз fair соблюдён\n";
+    return 0;
 }
 
-int main() {
-    cin >> allThreads; // Ввод общего количества потоков
-    vector<int> types(allThreads);
+int main(int argc, char* argv[]) {
+    // n3 --bench [--readers=N --writers=N --duration-ms=N --cs-ns=N --think-ns=N --policy=reader|writer|fair --lock=shared|distributed|seqlock --combine=0|1
+    //           --shards=N --keys=N --zipf=S --multi-ratio=F]
+    // n3 --check-fair - проверка порядка фаз политики fair
+    if (argc > 1 && string(argv[1]) == "--check-fair") {
+        return checkFairOrdering();
+    }
+
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        try {
+            return runBenchmark(parseBenchConfig(argc, argv, 2));
+        } catch (const exception& e) {
+            cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Необязательные аргументы: вид блокировки (shared, distributed или seqlock)
+    // и combine - объединять записи писателей в пакеты
+    if (argc > 2) {
+        if (string(argv[2]) != "combine") {
+            cerr << "Неизвестный режим записи: " << argv[2] << "\n";
+            return 1;
+        }
+        combineWrites = true;
+    }
+    if (argc > 1) {
+        string kind = argv[1];
+        if (kind == "shared") lockKind = LockKind::shared;
+        else if (kind == "distributed") lockKind = LockKind::distributed;
+        else if (kind == "seqlock") lockKind = LockKind::seqlock;
+        else {
+            cerr << "Неизвестный вид блокировки: " << kind << "\n";
+            return 1;
+        }
+    }
 
-    // Ввод типов потоков (0 — читатель, 1 — писатель)
+    int opsCnt;
+    cin >> opsCnt; // Ввод общего количества операций
+    vector<int> types(opsCnt);
+
+    // Ввод типов операций (0 — читатель, 1 — писатель)
     for (auto& t : types) {
         cin >> t;
     }
 
-    // Создаем потоки в зависимости от их типа
-    for (int i = 0; i < allThreads; ++i) {
+    // Операции выполняются ограниченным пулом потоков; очередь не даёт вводу обогнать пул.
+    // Ожидающие в блокировке операции уже заняли свои потоки, поэтому пул не может
+    // зависнуть, даже если потоков меньше, чем операций
+    Executor executor(max(4u, thread::hardware_concurrency()), 1024);
+    Latch done(opsCnt);
+
+    for (int i = 0; i < opsCnt; ++i) {
         auto type = static_cast<Type>(types[i]);
-        thread th((type == Type::writer ? writer : reader), i);
-        th.detach(); // Потоки работают в фоне
+        executor.submit([type, i, &done] {
+            (type == Type::writer ? writer : reader)(i);
+            done.countDown();
+        });
     }
 
-    // Ожидаем завершения всех потоков
-    while (allThreads > 0);
-}
\ No newline at end of file
+    // Ожидаем завершения всех операций без активного ожидания
+    done.wait();
+}